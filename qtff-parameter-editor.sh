@@ -31,8 +31,6 @@
 ## POSSIBILITY OF SUCH DAMAGE.
 ## 
  
-ffprobe_exe=""
- 
 #define the tabels as globals
 primaries=("Reserved"
            "ITU-R BT.709"
@@ -196,96 +194,54 @@ outputHelp()
 
 
 
-outputInfoMovWrapper()
+outputInfo()
 {
   ipFile=$1
-  ${dir}/src/movdump $ipFile > ${ipFile%.mov}.dump
-  colrline=$(grep -hnr "colr:"  ${ipFile%.mov}.dump)
-  colrline=${colrline%%:*}
-  
-  if [ "$colrline" == "" ]
+  info=$(${dir}/src/rdd36mod -s -q ${ipFile} 2>&1)
+
+  errorline=$(echo "$info" | grep -i "failed")
+  if [ "$errorline" != "" ]
   then
-    echo "colr atom not located, unable to display any further information or make any edits"
-    exit    
-  else
-    head -n $(($colrline+4)) ${ipFile%.mov}.dump | tail -n 5 | sed -e 's/^[[:space:]]*//' > ${ipFile%.mov}_useful.dump
-    thisPrimary=$(grep "primaries" ${ipFile%.mov}_useful.dump)
-    thistf=$(grep "transfer" ${ipFile%.mov}_useful.dump)
-    thismatrix=$(grep "matrix" ${ipFile%.mov}_useful.dump)
-    
-    thisPrimary=${thisPrimary#*:}
-    thistf=${thistf#*:}
-    thismatrix=${thismatrix#*:}
-    thisPrimary=$(echo ${thisPrimary} | tr -d '[:space:]')
-    thistf=$(echo ${thistf} | tr -d '[:space:]')
-    thismatrix=$(echo ${thismatrix} | tr -d '[:space:]')
-    
-    echo 
-    echo "File = $ipFile"
-    echo 
-    echo "MOV Wrapper Information (COLR atom)"
-    echo "Primary = $thisPrimary (${primaries[${thisPrimary}]})"
-    echo "Transfer Function = $thistf (${tf[${thistf}]})"
-    echo "Matrix = $thismatrix (${matrix[${thismatrix}]})"
-    echo 
-    
-    
+    echo "ProRes header not found, unable to edit this file"
+    exit
   fi
-}
-
-
-###########################################################################################
-
 
-outputInfoProRes()
-{
-  ipFile=$1
-  leaf=${ipFile%.mov}
-  ${ffprobe_exe} -loglevel panic -show_packets -select_streams v:0 ${ipFile} | grep pos > ${leaf}_offsets.txt
-  ${dir}/src/rdd36mod -s -o ${leaf}_offsets.txt ${ipFile} > ${leaf}_rdd36mod.txt 2>&1
-  
-  #cat ${leaf}_rdd36mod.txt
-  errorline=$(grep "failed" ${leaf}_rdd36mod.txt)
-  if [ "$errorline" == "" ]
+  colrinfo=$(echo "$info" | grep -A3 "'colr' atom properties")
+  if [ "$colrinfo" == "" ]
   then
-  
-    thisPrimary=$(grep "primaries" ${leaf}_rdd36mod.txt)
-    thistf=$(grep "transfer" ${leaf}_rdd36mod.txt)
-    thismatrix=$(grep "matrix" ${leaf}_rdd36mod.txt)
-    
-    thisPrimary=${thisPrimary#*:}
-    thistf=${thistf#*:}
-    thismatrix=${thismatrix#*:}
-    thisPrimary=$(echo ${thisPrimary} | tr -d '[:space:]')
-    thistf=$(echo ${thistf} | tr -d '[:space:]')
-    thismatrix=$(echo ${thismatrix} | tr -d '[:space:]')
-    
-    echo 
-    echo "SMPTE RDD 36 (Apple ProRes) Information"
-    echo "Primary = $thisPrimary (${primaries[${thisPrimary}]})"
-    echo "Transfer Function = $thistf (${tf[${thistf}]})"
-    echo "Matrix = $thismatrix (${matrix[${thismatrix}]})"
-    echo  
-    
-  else
-    echo "ProRes header not found, unable to edit this file"
+    echo "colr atom not located, unable to display any further information or make any edits"
     exit
   fi
+  frameinfo=$(echo "$info" | grep -A5 "First frame properties")
+
+  echo
+  echo "File = $ipFile"
+  echo
+  echo "MOV Wrapper Information (COLR atom)"
+  outputProperties "$colrinfo"
+  echo
+  echo "SMPTE RDD 36 (Apple ProRes) Information"
+  outputProperties "$frameinfo"
+  echo
 }
 
 
 ###########################################################################################
 
 
-
-cleanup()
+outputProperties()
 {
-  ipFile=$1
-  leaf=${ipFile%.mov}
-  rm -f ${leaf}_useful.dump
-  rm -f ${leaf}.dump
-  rm -f ${leaf}_rdd36mod.txt
-  rm -f ${leaf}_offsets.txt
+  thisPrimary=$(echo "$1" | grep "primaries")
+  thistf=$(echo "$1" | grep "transfer")
+  thismatrix=$(echo "$1" | grep "matrix")
+
+  thisPrimary=$(echo ${thisPrimary#*:} | tr -d '[:space:]')
+  thistf=$(echo ${thistf#*:} | tr -d '[:space:]')
+  thismatrix=$(echo ${thismatrix#*:} | tr -d '[:space:]')
+
+  echo "Primary = $thisPrimary (${primaries[${thisPrimary}]})"
+  echo "Transfer Function = $thistf (${tf[${thistf}]})"
+  echo "Matrix = $thismatrix (${matrix[${thismatrix}]})"
 }
 
 
@@ -301,10 +257,7 @@ cloneMovAndModify()
   newTF=$4 
   newMatrix=$5
   
-  leaf=${ipFile%.mov}
-  
-  outputInfoMovWrapper $ipFile
-  outputInfoProRes $ipFile
+  outputInfo $ipFile
   
   if [ "$ipFile" = "$opFile" ]
   then
@@ -317,84 +270,51 @@ cloneMovAndModify()
     else
       echo "Not updating file ..."
       echo "Exiting"
-      cleanup $ipFile
       exit
     fi    
     
     echo "Processing with adjustment ..."
-  else
-    echo "Cloning ..."
-    pvavail=$(command -v pv)
-    if [[ -n "${pvavail/[ ]*\n/}" ]] 
-    then
-      pv $ipFile > $opFile
-    else 
-      cp -v $ipFile $opFile
-    fi
   fi
   
-  #get the offset
-  offset=$(grep -hr "colr" ${ipFile%.mov}_useful.dump)
-  offset=${offset#*o=}
-  offset=${offset%(*}
-  offset=$(echo ${offset} | tr -d '[:space:]')
-  
+  # the colr atom and all frame headers are updated and verified in a single rdd36mod run
+  modopts=""
   if [ "$newPrim" != "-1" ]
   then
     echo "Modifying the primary ..."
-    primhex=$(printf "%02x" $newPrim)    
-    printf "\x${primhex}" | dd conv=notrunc of=$opFile bs=1 seek=$(($offset + 13)) &> /dev/null 
-    ${dir}/src/rdd36mod -o ${leaf}_offsets.txt -p $newPrim  ${opFile}    
+    modopts="$modopts -p $newPrim"
   fi  
-  
   if [ "$newTF" != "-1" ]
   then
     echo "Modifying the transfer function ..." 
-    tfhex=$(printf "%02x" $newTF)   
-    printf "\x${tfhex}" | dd conv=notrunc of=$opFile bs=1 seek=$(($offset + 15)) &> /dev/null 
-    ${dir}/src/rdd36mod -o ${leaf}_offsets.txt -t $newTF  ${opFile}   
+    modopts="$modopts -t $newTF"
   fi 
-  
   if [ "$newMatrix" != "-1" ]
   then
     echo "Modifying the matrix ..." 
-    matrixhex=$(printf "%02x" $newMatrix) 
-    printf "\x${matrixhex}" | dd conv=notrunc of=$opFile bs=1 seek=$(($offset + 17)) &> /dev/null
-   ${dir}/src/rdd36mod -o ${leaf}_offsets.txt -m $newMatrix  ${opFile}       
+    modopts="$modopts -m $newMatrix"
   fi 
-  
-  outputInfoMovWrapper $opFile
-  outputInfoProRes $opFile
-}
-
-
-###########################################################################################
-
-
-checkffprobe()
-{
-  if type ffprobe 2>/dev/null
+  if [ "$ipFile" != "$opFile" ]
   then
-    echo "Found ffprobe in the PATH"
-    ffprobe_exe=$(which ffprobe)
-  else
-    echo "ffprobe not found in the PATH,"
-    echo "Please provide the location of ffprobe, followed by [ENTER] "
-    read ffprobe_exe
-    if type ${ffprobe_exe} >/dev/null 2>&1
+    # rdd36mod clones the input using a reflink or an in-kernel copy before modifying the output
+    echo "Cloning ..."
+    if [ "$modopts" != "" ]
     then
-      echo "Found ffprobe in the location ${ffprobe_exe}"
+      ${dir}/src/rdd36mod -q -c --output ${opFile} $modopts ${ipFile}
     else
-      echo "ffprobe not found, it is required"
-      echo "Exiting"
-      exit
-    fi    
+      cp -v $ipFile $opFile
+    fi
+  elif [ "$modopts" != "" ]
+  then
+    ${dir}/src/rdd36mod -q -c $modopts ${opFile}
   fi
+  
+  outputInfo $opFile
 }
 
 
 ###########################################################################################
 
+
 dir=$(dirname $0)
 
 if [ "$#" = "0" ]
@@ -406,10 +326,7 @@ then
   then
     outputHelp
   else
-    checkffprobe
-    outputInfoMovWrapper $1
-    outputInfoProRes $1
-    cleanup $1
+    outputInfo $1
   fi
 else
   newPrim=-1
@@ -435,10 +352,7 @@ else
     fi    
   done
   
-  checkffprobe
   cloneMovAndModify $1 $2 $newPrim $newTF $newMatrix
-  cleanup $1
-  cleanup $2
 fi
    
 
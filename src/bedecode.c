@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "bedecode.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+typedef void (*DecodeUInt32Func)(uint32_t *values, const unsigned char *bytes, size_t count);
+typedef void (*DecodeUInt64Func)(uint64_t *values, const unsigned char *bytes, size_t count);
+typedef size_t (*FindTagFunc)(const unsigned char *bytes, size_t size, uint32_t tag);
+
+
+static void decode_uint32_scalar(uint32_t *values, const unsigned char *bytes, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++) {
+        values[i] = (((uint32_t)bytes[4 * i    ]) << 24) |
+                    (((uint32_t)bytes[4 * i + 1]) << 16) |
+                    (((uint32_t)bytes[4 * i + 2]) << 8) |
+                      (uint32_t)bytes[4 * i + 3];
+    }
+}
+
+static void decode_uint64_scalar(uint64_t *values, const unsigned char *bytes, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++) {
+        values[i] = (((uint64_t)bytes[8 * i    ]) << 56) |
+                    (((uint64_t)bytes[8 * i + 1]) << 48) |
+                    (((uint64_t)bytes[8 * i + 2]) << 40) |
+                    (((uint64_t)bytes[8 * i + 3]) << 32) |
+                    (((uint64_t)bytes[8 * i + 4]) << 24) |
+                    (((uint64_t)bytes[8 * i + 5]) << 16) |
+                    (((uint64_t)bytes[8 * i + 6]) << 8) |
+                      (uint64_t)bytes[8 * i + 7];
+    }
+}
+
+static size_t find_tag_scalar(const unsigned char *bytes, size_t size, uint32_t tag)
+{
+    const unsigned char *first;
+    size_t i = 0;
+
+    // memchr is usually vectorized by the C library
+    while (i + 4 <= size) {
+        first = (const unsigned char*)memchr(&bytes[i], (int)(tag >> 24), size - 3 - i);
+        if (!first)
+            break;
+        i = first - bytes;
+        if (bytes[i + 1] == (unsigned char)(tag >> 16) &&
+            bytes[i + 2] == (unsigned char)(tag >> 8) &&
+            bytes[i + 3] == (unsigned char)tag)
+        {
+            return i;
+        }
+        i++;
+    }
+
+    return size;
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__((target("ssse3")))
+static void decode_uint32_ssse3(uint32_t *values, const unsigned char *bytes, size_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        __m128i data = _mm_loadu_si128((const __m128i*)&bytes[4 * i]);
+        _mm_storeu_si128((__m128i*)&values[i], _mm_shuffle_epi8(data, shuffle));
+    }
+    decode_uint32_scalar(&values[i], &bytes[4 * i], count - i);
+}
+
+__attribute__((target("ssse3")))
+static void decode_uint64_ssse3(uint64_t *values, const unsigned char *bytes, size_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    size_t i;
+
+    for (i = 0; i + 2 <= count; i += 2) {
+        __m128i data = _mm_loadu_si128((const __m128i*)&bytes[8 * i]);
+        _mm_storeu_si128((__m128i*)&values[i], _mm_shuffle_epi8(data, shuffle));
+    }
+    decode_uint64_scalar(&values[i], &bytes[8 * i], count - i);
+}
+
+// _mm256_shuffle_epi8 shuffles within each 128-bit lane and so the lanes use the same pattern
+__attribute__((target("avx2")))
+static void decode_uint32_avx2(uint32_t *values, const unsigned char *bytes, size_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        __m256i data0 = _mm256_loadu_si256((const __m256i*)&bytes[4 * i]);
+        __m256i data1 = _mm256_loadu_si256((const __m256i*)&bytes[4 * i + 32]);
+        _mm256_storeu_si256((__m256i*)&values[i],     _mm256_shuffle_epi8(data0, shuffle));
+        _mm256_storeu_si256((__m256i*)&values[i + 8], _mm256_shuffle_epi8(data1, shuffle));
+    }
+    for (; i + 8 <= count; i += 8) {
+        __m256i data = _mm256_loadu_si256((const __m256i*)&bytes[4 * i]);
+        _mm256_storeu_si256((__m256i*)&values[i], _mm256_shuffle_epi8(data, shuffle));
+    }
+    decode_uint32_scalar(&values[i], &bytes[4 * i], count - i);
+}
+
+__attribute__((target("avx2")))
+static void decode_uint64_avx2(uint64_t *values, const unsigned char *bytes, size_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    size_t i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256i data0 = _mm256_loadu_si256((const __m256i*)&bytes[8 * i]);
+        __m256i data1 = _mm256_loadu_si256((const __m256i*)&bytes[8 * i + 32]);
+        _mm256_storeu_si256((__m256i*)&values[i],     _mm256_shuffle_epi8(data0, shuffle));
+        _mm256_storeu_si256((__m256i*)&values[i + 4], _mm256_shuffle_epi8(data1, shuffle));
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m256i data = _mm256_loadu_si256((const __m256i*)&bytes[8 * i]);
+        _mm256_storeu_si256((__m256i*)&values[i], _mm256_shuffle_epi8(data, shuffle));
+    }
+    decode_uint64_scalar(&values[i], &bytes[8 * i], count - i);
+}
+
+// The compares select the positions where the first and last byte of the tag match and the middle bytes
+// are checked for each of those candidates
+static int middle_tag_bytes_match(const unsigned char *bytes, uint32_t tag)
+{
+    return bytes[1] == (unsigned char)(tag >> 16) && bytes[2] == (unsigned char)(tag >> 8);
+}
+
+__attribute__((target("sse2")))
+static size_t find_tag_sse2(const unsigned char *bytes, size_t size, uint32_t tag)
+{
+    const __m128i first = _mm_set1_epi8((char)(tag >> 24));
+    const __m128i last  = _mm_set1_epi8((char)tag);
+    unsigned mask;
+    size_t i;
+
+    for (i = 0; i + 16 + 3 <= size; i += 16) {
+        __m128i first_eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&bytes[i]), first);
+        __m128i last_eq  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&bytes[i + 3]), last);
+        mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(first_eq, last_eq));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (middle_tag_bytes_match(&bytes[i + bit], tag))
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return i + find_tag_scalar(&bytes[i], size - i, tag);
+}
+
+__attribute__((target("avx2")))
+static size_t find_tag_avx2(const unsigned char *bytes, size_t size, uint32_t tag)
+{
+    const __m256i first = _mm256_set1_epi8((char)(tag >> 24));
+    const __m256i last  = _mm256_set1_epi8((char)tag);
+    uint64_t mask;
+    size_t i;
+
+    for (i = 0; i + 64 + 3 <= size; i += 64) {
+        __m256i first_eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&bytes[i]), first);
+        __m256i last_eq0  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&bytes[i + 3]), last);
+        __m256i first_eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&bytes[i + 32]), first);
+        __m256i last_eq1  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)&bytes[i + 35]), last);
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(first_eq0, last_eq0)) |
+               ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_and_si256(first_eq1, last_eq1)) << 32);
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctzll(mask);
+            if (middle_tag_bytes_match(&bytes[i + bit], tag))
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return i + find_tag_scalar(&bytes[i], size - i, tag);
+}
+
+#endif
+
+
+// the scalar functions are used until be_decode_init() selects the SIMD functions
+static DecodeUInt32Func g_decode_uint32 = decode_uint32_scalar;
+static DecodeUInt64Func g_decode_uint64 = decode_uint64_scalar;
+static FindTagFunc g_find_tag = find_tag_scalar;
+
+void be_decode_init(void)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        g_decode_uint32 = decode_uint32_avx2;
+        g_decode_uint64 = decode_uint64_avx2;
+        g_find_tag = find_tag_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        g_decode_uint32 = decode_uint32_ssse3;
+        g_decode_uint64 = decode_uint64_ssse3;
+        g_find_tag = find_tag_sse2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        g_find_tag = find_tag_sse2;
+    }
+#endif
+}
+
+
+void be_decode_uint32(uint32_t *values, const unsigned char *bytes, size_t count)
+{
+    g_decode_uint32(values, bytes, count);
+}
+
+void be_decode_uint64(uint64_t *values, const unsigned char *bytes, size_t count)
+{
+    g_decode_uint64(values, bytes, count);
+}
+
+size_t be_find_tag(const unsigned char *bytes, size_t size, uint32_t tag)
+{
+    return g_find_tag(bytes, size, tag);
+}
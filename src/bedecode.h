@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BEDECODE_H_
+#define BEDECODE_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Selects the SIMD functions supported by the CPU. Call it once at the start of main(), before any threads are
+// created, because the selection is not synchronized. The portable scalar functions are used until it is called
+void be_decode_init(void);
+
+// Decode arrays of big-endian values, e.g. Quicktime sample tables, into native values. The byte swapping uses
+// AVX2 or SSSE3 shuffles if supported by the CPU, otherwise it falls back to portable scalar code
+void be_decode_uint32(uint32_t *values, const unsigned char *bytes, size_t count);
+void be_decode_uint64(uint64_t *values, const unsigned char *bytes, size_t count);
+
+// Returns the position of the first occurrence of the big-endian 4 byte <tag>, e.g. 'icpf', in <bytes>, or <size>
+// if it isn't found. The search uses AVX2 or SSE2 compares if supported by the CPU
+size_t be_find_tag(const unsigned char *bytes, size_t size, uint32_t tag);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,594 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "frameindex.h"
+#include "bedecode.h"
+
+
+#define INDEX_FILE_ID           0x72646669  // 'rdfi'
+#define INDEX_FILE_VERSION      1
+#define INDEX_HEADER_SIZE       48
+#define INDEX_ENTRY_SIZE        24
+#define INDEX_CHECKSUM_SIZE     8
+
+#define KEYFRAME_FLAG           0x00000001
+
+#define RDD36_FRAME_ID          0x69637066  // 'icpf'
+#define MIN_FRAME_HEADER_SIZE   20
+// frame_size, frame_identifier and frame_header_size
+#define FRAME_PREFIX_SIZE       10
+#define SCAN_BUFFER_SIZE        (4 * 1024 * 1024)
+
+
+// A window into the file data that is either a memory mapping of the whole file or a buffer filled using pread
+typedef struct
+{
+    int fd;
+    const unsigned char *map;
+    unsigned char *buffer;
+    const unsigned char *data;
+    int64_t offset;
+    int64_t size;
+} ScanWindow;
+
+
+void frame_index_init(FrameIndex *index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+void frame_index_clear(FrameIndex *index)
+{
+    free(index->entries);
+    frame_index_init(index);
+}
+
+int frame_index_reserve(FrameIndex *index, size_t count)
+{
+    FrameIndexEntry *new_entries;
+
+    if (count <= index->alloc_count)
+        return 1;
+
+    new_entries = (FrameIndexEntry*)realloc(index->entries, count * sizeof(FrameIndexEntry));
+    if (!new_entries) {
+        fprintf(stderr, "Failed to allocate frame index\n");
+        return 0;
+    }
+    index->entries = new_entries;
+    index->alloc_count = count;
+
+    return 1;
+}
+
+int frame_index_append(FrameIndex *index, int64_t offset, uint32_t size)
+{
+    if (index->count >= index->alloc_count &&
+        !frame_index_reserve(index, (index->alloc_count ? index->alloc_count * 2 : 1024)))
+    {
+        return 0;
+    }
+
+    index->entries[index->count].frame_num = (int64_t)index->count;
+    index->entries[index->count].offset = offset;
+    index->entries[index->count].size   = size;
+    index->entries[index->count].keyframe = 1;
+    index->count++;
+
+    return 1;
+}
+
+static int read_next_frame_offset(FILE *offsets_file, int64_t *offset_out)
+{
+    char line[1024];
+    size_t i;
+
+    while (1) {
+        if (!fgets(line, sizeof(line), offsets_file))
+            return 0;
+        for (i = 0; i < sizeof(line); i++) {
+            if ((line[i] >= '0' && line[i] <= '9') || !line[i])
+                break;
+        }
+        if (i < sizeof(line) && line[i]) {
+            int64_t offset;
+            if (sscanf(&line[i], "%" PRId64, &offset) == 1 && offset >= 0) {
+                *offset_out = offset;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int frame_index_read_offsets_file(FrameIndex *index, const char *filename)
+{
+    FILE *offsets_file;
+    int64_t offset;
+    int result = 1;
+
+    offsets_file = fopen(filename, "rb");
+    if (!offsets_file) {
+        fprintf(stderr, "Failed to open offsets file '%s': %s\n", filename, strerror(errno));
+        return 0;
+    }
+
+    while (read_next_frame_offset(offsets_file, &offset)) {
+        if (!frame_index_append(index, offset, 0)) {
+            result = 0;
+            break;
+        }
+    }
+
+    fclose(offsets_file);
+
+    return result;
+}
+
+static uint32_t get_uint32(const unsigned char *bytes)
+{
+    return (((uint32_t)bytes[0]) << 24) |
+           (((uint32_t)bytes[1]) << 16) |
+           (((uint32_t)bytes[2]) << 8) |
+             (uint32_t)bytes[3];
+}
+
+static uint64_t get_uint64(const unsigned char *bytes)
+{
+    return (((uint64_t)get_uint32(bytes)) << 32) | get_uint32(&bytes[4]);
+}
+
+static void put_uint32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = (unsigned char)(value >> 24);
+    bytes[1] = (unsigned char)(value >> 16);
+    bytes[2] = (unsigned char)(value >> 8);
+    bytes[3] = (unsigned char)value;
+}
+
+static void put_uint64(unsigned char *bytes, uint64_t value)
+{
+    put_uint32(bytes, (uint32_t)(value >> 32));
+    put_uint32(&bytes[4], (uint32_t)value);
+}
+
+static uint16_t get_uint16(const unsigned char *bytes)
+{
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+int frame_index_scan_raw_file(FrameIndex *index, int fd)
+{
+    unsigned char bytes[8];
+    int64_t offset = 0;
+    uint32_t frame_size;
+    ssize_t num_read;
+
+    while (1) {
+        num_read = pread(fd, bytes, sizeof(bytes), offset);
+        if (num_read == 0)
+            break;
+        if (num_read < 0) {
+            fprintf(stderr, "File read error: %s\n", strerror(errno));
+            return 0;
+        }
+
+        frame_size = get_uint32(bytes);
+        if (!frame_index_append(index, offset, frame_size))
+            return 0;
+        if (num_read != sizeof(bytes) || frame_size < sizeof(bytes) || get_uint32(&bytes[4]) != RDD36_FRAME_ID)
+            break;
+        offset += frame_size;
+    }
+
+    return 1;
+}
+
+static int load_scan_window(ScanWindow *window, int64_t offset, int64_t end)
+{
+    int64_t size;
+    ssize_t num_read;
+
+    if (window->map) {
+        window->data   = &window->map[offset];
+        window->offset = offset;
+        window->size   = end - offset;
+        return 1;
+    }
+
+    size = end - offset;
+    if (size > SCAN_BUFFER_SIZE)
+        size = SCAN_BUFFER_SIZE;
+    window->data   = window->buffer;
+    window->offset = offset;
+    window->size   = 0;
+    while (window->size < size) {
+        num_read = pread(window->fd, &window->buffer[window->size], (size_t)(size - window->size),
+                         offset + window->size);
+        if (num_read < 0 && errno == EINTR)
+            continue;
+        if (num_read <= 0) {
+            fprintf(stderr, "File read error: %s\n", (num_read < 0 ? strerror(errno) : "unexpected end of file"));
+            return 0;
+        }
+        window->size += num_read;
+    }
+
+    return 1;
+}
+
+int frame_index_scan_file(FrameIndex *index, int fd, int64_t start, int64_t end)
+{
+    ScanWindow window;
+    struct stat st;
+    const unsigned char *frame;
+    size_t search_size;
+    size_t pos;
+    int64_t offset;
+    uint32_t frame_size;
+    uint16_t frame_header_size;
+    int result = 1;
+
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        return 0;
+    }
+    if (end < 0 || end > st.st_size)
+        end = st.st_size;
+    if (start < 0 || end - start < FRAME_PREFIX_SIZE)
+        return 1;
+
+    // the whole file is mapped so that only the pages containing frame headers and the data between frames
+    // are read. pread is used if the file can't be mapped, e.g. a 32-bit build and a large file
+    memset(&window, 0, sizeof(window));
+    window.fd = fd;
+    window.offset = -1;
+    if ((uint64_t)st.st_size <= (size_t)-1) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+            window.map = (const unsigned char*)map;
+    }
+    if (!window.map) {
+        window.buffer = (unsigned char*)malloc(SCAN_BUFFER_SIZE);
+        if (!window.buffer) {
+            fprintf(stderr, "Failed to allocate scan buffer\n");
+            return 0;
+        }
+    }
+
+    offset = start;
+    while (end - offset >= FRAME_PREFIX_SIZE) {
+        if (offset < window.offset || offset + FRAME_PREFIX_SIZE > window.offset + window.size) {
+            if (!load_scan_window(&window, offset, end)) {
+                result = 0;
+                break;
+            }
+        }
+
+        // search for a frame_identifier that is preceded by the frame_size and followed by the
+        // frame_header_size in the window
+        frame = &window.data[offset - window.offset];
+        search_size = (size_t)(window.offset + window.size - offset) - FRAME_PREFIX_SIZE + 4;
+        pos = be_find_tag(&frame[4], search_size, RDD36_FRAME_ID);
+        if (pos == search_size) {
+            offset += search_size - 3;
+            continue;
+        }
+        frame += pos;
+        offset += pos;
+
+        frame_size = get_uint32(frame);
+        frame_header_size = get_uint16(&frame[8]);
+        if (frame_header_size < MIN_FRAME_HEADER_SIZE ||
+            frame_size < 8 + (uint32_t)frame_header_size ||
+            frame_size > end - offset)
+        {
+            offset++;
+            continue;
+        }
+
+        if (!frame_index_append(index, offset, frame_size)) {
+            result = 0;
+            break;
+        }
+        offset += frame_size;
+    }
+
+    if (window.map)
+        munmap((void*)window.map, (size_t)st.st_size);
+    free(window.buffer);
+
+    return result;
+}
+
+void frame_index_select(FrameIndex *index, int64_t start, int64_t count, int64_t every)
+{
+    size_t i, j;
+
+    for (i = 0, j = 0; i < index->count && (count < 0 || (int64_t)j < count); i++) {
+        int64_t frame_num = index->entries[i].frame_num;
+        if (frame_num >= start && (frame_num - start) % every == 0)
+            index->entries[j++] = index->entries[i];
+    }
+    index->count = j;
+}
+
+static int compare_entry_offsets(const void *left, const void *right)
+{
+    int64_t left_offset  = ((const FrameIndexEntry*)left)->offset;
+    int64_t right_offset = ((const FrameIndexEntry*)right)->offset;
+
+    return (left_offset > right_offset) - (left_offset < right_offset);
+}
+
+void frame_index_sort(FrameIndex *index)
+{
+    size_t i, j;
+
+    if (index->count < 2)
+        return;
+
+    qsort(index->entries, index->count, sizeof(FrameIndexEntry), compare_entry_offsets);
+
+    for (i = 0, j = 1; j < index->count; j++) {
+        if (index->entries[j].offset != index->entries[i].offset)
+            index->entries[++i] = index->entries[j];
+    }
+    index->count = i + 1;
+}
+
+uint64_t frame_index_hash(const unsigned char *data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+int frame_index_get_source(int fd, FrameIndexSource *source)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        return 0;
+    }
+
+    source->file_size  = st.st_size;
+    source->mtime_sec  = st.st_mtim.tv_sec;
+    source->mtime_nsec = (int32_t)st.st_mtim.tv_nsec;
+    source->moov_hash  = 0;
+
+    return 1;
+}
+
+int frame_index_source_matches(const FrameIndexSource *left, const FrameIndexSource *right, int compare_mtime)
+{
+    if (left->file_size != right->file_size)
+        return 0;
+    if (compare_mtime)
+        return left->mtime_sec == right->mtime_sec && left->mtime_nsec == right->mtime_nsec;
+    else
+        return left->moov_hash != 0 && left->moov_hash == right->moov_hash;
+}
+
+static void write_header(unsigned char *bytes, size_t count, const FrameIndexSource *source)
+{
+    put_uint32(&bytes[0],  INDEX_FILE_ID);
+    put_uint32(&bytes[4],  INDEX_FILE_VERSION);
+    put_uint64(&bytes[8],  count);
+    put_uint64(&bytes[16], (uint64_t)source->file_size);
+    put_uint64(&bytes[24], (uint64_t)source->mtime_sec);
+    put_uint32(&bytes[32], (uint32_t)source->mtime_nsec);
+    put_uint32(&bytes[36], 0);
+    put_uint64(&bytes[40], source->moov_hash);
+}
+
+static int write_index_data(const unsigned char *data, size_t size, const char *filename)
+{
+    FILE *file;
+    int result = 1;
+
+    file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open frame index file '%s': %s\n", filename, strerror(errno));
+        return 0;
+    }
+    if (fwrite(data, 1, size, file) != size) {
+        fprintf(stderr, "Failed to write frame index file '%s': %s\n", filename, strerror(errno));
+        result = 0;
+    }
+    if (fclose(file) != 0 && result) {
+        fprintf(stderr, "Failed to write frame index file '%s': %s\n", filename, strerror(errno));
+        result = 0;
+    }
+
+    return result;
+}
+
+static int read_index_data(const char *filename, unsigned char **data, size_t *size)
+{
+    struct stat st;
+    FILE *file;
+    int result = 1;
+
+    file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open frame index file '%s': %s\n", filename, strerror(errno));
+        return 0;
+    }
+    if (fstat(fileno(file), &st) < 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        fclose(file);
+        return 0;
+    }
+
+    *size = (size_t)st.st_size;
+    *data = (unsigned char*)malloc(*size ? *size : 1);
+    if (!*data) {
+        fprintf(stderr, "Failed to allocate frame index file buffer\n");
+        result = 0;
+    } else if (fread(*data, 1, *size, file) != *size) {
+        fprintf(stderr, "Failed to read frame index file '%s'\n", filename);
+        free(*data);
+        *data = NULL;
+        result = 0;
+    }
+    fclose(file);
+
+    if (result &&
+        (*size < INDEX_HEADER_SIZE + INDEX_CHECKSUM_SIZE ||
+            get_uint32(*data) != INDEX_FILE_ID ||
+            get_uint64(&(*data)[*size - INDEX_CHECKSUM_SIZE]) != frame_index_hash(*data, *size - INDEX_CHECKSUM_SIZE)))
+    {
+        fprintf(stderr, "'%s' is not a valid frame index file\n", filename);
+        result = 0;
+    }
+    if (result && get_uint32(&(*data)[4]) != INDEX_FILE_VERSION) {
+        fprintf(stderr, "Frame index file '%s' version %u is not supported\n", filename, get_uint32(&(*data)[4]));
+        result = 0;
+    }
+    if (result && (*size - INDEX_HEADER_SIZE - INDEX_CHECKSUM_SIZE) / INDEX_ENTRY_SIZE != get_uint64(&(*data)[8])) {
+        fprintf(stderr, "'%s' is not a valid frame index file\n", filename);
+        result = 0;
+    }
+    if (!result) {
+        free(*data);
+        *data = NULL;
+    }
+
+    return result;
+}
+
+int frame_index_write_file(const FrameIndex *index, const FrameIndexSource *source, const char *filename)
+{
+    size_t size = INDEX_HEADER_SIZE + index->count * INDEX_ENTRY_SIZE + INDEX_CHECKSUM_SIZE;
+    unsigned char *data;
+    unsigned char *bytes;
+    size_t i;
+    int result;
+
+    data = (unsigned char*)malloc(size);
+    if (!data) {
+        fprintf(stderr, "Failed to allocate frame index file buffer\n");
+        return 0;
+    }
+
+    write_header(data, index->count, source);
+    bytes = &data[INDEX_HEADER_SIZE];
+    for (i = 0; i < index->count; i++) {
+        put_uint64(&bytes[0],  (uint64_t)index->entries[i].frame_num);
+        put_uint64(&bytes[8],  (uint64_t)index->entries[i].offset);
+        put_uint32(&bytes[16], index->entries[i].size);
+        put_uint32(&bytes[20], (index->entries[i].keyframe ? KEYFRAME_FLAG : 0));
+        bytes += INDEX_ENTRY_SIZE;
+    }
+    put_uint64(bytes, frame_index_hash(data, size - INDEX_CHECKSUM_SIZE));
+
+    result = write_index_data(data, size, filename);
+    free(data);
+
+    return result;
+}
+
+int frame_index_read_file(FrameIndex *index, FrameIndexSource *source, const char *filename)
+{
+    unsigned char *data;
+    const unsigned char *bytes;
+    size_t size;
+    size_t count;
+    size_t i;
+
+    if (!read_index_data(filename, &data, &size))
+        return 0;
+
+    count = (size_t)get_uint64(&data[8]);
+    source->file_size  = (int64_t)get_uint64(&data[16]);
+    source->mtime_sec  = (int64_t)get_uint64(&data[24]);
+    source->mtime_nsec = (int32_t)get_uint32(&data[32]);
+    source->moov_hash  = get_uint64(&data[40]);
+
+    frame_index_clear(index);
+    index->entries = (FrameIndexEntry*)malloc((count ? count : 1) * sizeof(FrameIndexEntry));
+    if (!index->entries) {
+        fprintf(stderr, "Failed to allocate frame index\n");
+        free(data);
+        return 0;
+    }
+    index->alloc_count = (count ? count : 1);
+
+    bytes = &data[INDEX_HEADER_SIZE];
+    for (i = 0; i < count; i++) {
+        index->entries[i].frame_num = (int64_t)get_uint64(&bytes[0]);
+        index->entries[i].offset    = (int64_t)get_uint64(&bytes[8]);
+        index->entries[i].size      = get_uint32(&bytes[16]);
+        index->entries[i].keyframe  = !!(get_uint32(&bytes[20]) & KEYFRAME_FLAG);
+        bytes += INDEX_ENTRY_SIZE;
+    }
+    index->count = count;
+
+    free(data);
+
+    return 1;
+}
+
+int frame_index_update_file_source(const char *filename, const FrameIndexSource *source)
+{
+    unsigned char *data;
+    size_t size;
+    int result;
+
+    if (!read_index_data(filename, &data, &size))
+        return 0;
+
+    write_header(data, (size_t)get_uint64(&data[8]), source);
+    put_uint64(&data[size - INDEX_CHECKSUM_SIZE], frame_index_hash(data, size - INDEX_CHECKSUM_SIZE));
+
+    result = write_index_data(data, size, filename);
+    free(data);
+
+    return result;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAMEINDEX_H_
+#define FRAMEINDEX_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct
+{
+    int64_t frame_num;
+    int64_t offset;
+    uint32_t size;
+    int keyframe;
+} FrameIndexEntry;
+
+typedef struct
+{
+    FrameIndexEntry *entries;
+    size_t count;
+    size_t alloc_count;
+} FrameIndex;
+
+// Identifies the file that the frame index was created for
+typedef struct
+{
+    int64_t file_size;
+    int64_t mtime_sec;
+    int32_t mtime_nsec;
+    uint64_t moov_hash;     // hash of the 'moov' atom, 0 if it is not a Quicktime file
+} FrameIndexSource;
+
+
+void frame_index_init(FrameIndex *index);
+void frame_index_clear(FrameIndex *index);
+
+// Allocates space for <count> entries
+int frame_index_reserve(FrameIndex *index, size_t count);
+int frame_index_append(FrameIndex *index, int64_t offset, uint32_t size);
+
+// Reads a text file containing decimal file offsets for each frame separated by newlines,
+// e.g. 'ffprobe -show_packets -select_streams v:0 example.mov | grep pos >offsets.txt'
+int frame_index_read_offsets_file(FrameIndex *index, const char *filename);
+
+// Walks the frame_size fields of a raw RDD 36 (ProRes) bitstream. The walk stops at the first
+// frame that doesn't have a valid frame_size and 'icpf' frame_identifier, which is included in the
+// index so that it is reported when the frame is parsed
+int frame_index_scan_raw_file(FrameIndex *index, int fd);
+
+// Searches the byte range [<start>, <end>) of the file for RDD 36 (ProRes) frames, e.g. in a raw bitstream or a
+// capture without usable sample tables where the frames are interleaved with audio or padding. A candidate 'icpf'
+// frame_identifier is accepted if the frame_size and frame_header_size are consistent and the frame ends within
+// the range. The search continues after the end of each accepted frame. The end of the file is used if <end> < 0
+int frame_index_scan_file(FrameIndex *index, int fd, int64_t start, int64_t end);
+
+// Keeps every <every>th frame starting at frame number <start>, up to <count> frames if <count> >= 0
+void frame_index_select(FrameIndex *index, int64_t start, int64_t count, int64_t every);
+
+// Sorts the entries by file offset and removes duplicates
+void frame_index_sort(FrameIndex *index);
+
+// Binary frame index file containing the frame number, file offset, size and keyframe flag of each
+// frame and the identity of the source file. The file is versioned and has a checksum
+int frame_index_write_file(const FrameIndex *index, const FrameIndexSource *source, const char *filename);
+int frame_index_read_file(FrameIndex *index, FrameIndexSource *source, const char *filename);
+// Replaces the source identity in an existing frame index file, e.g. after the source was modified
+int frame_index_update_file_source(const char *filename, const FrameIndexSource *source);
+
+// Sets the size and modification time of the source file. The moov_hash is set to 0
+int frame_index_get_source(int fd, FrameIndexSource *source);
+// Returns 1 if the file sizes match and either the modification times or non-zero 'moov' hashes match
+int frame_index_source_matches(const FrameIndexSource *left, const FrameIndexSource *right, int compare_mtime);
+
+// 64-bit FNV-1a hash
+uint64_t frame_index_hash(const unsigned char *data, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
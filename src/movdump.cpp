@@ -50,11 +50,19 @@
 #include <unistd.h>
 #endif
 #include <limits.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
 
 #include <vector>
 #include <string>
 #include <exception>
 
+#include "bedecode.h"
+
 using namespace std;
 
 
@@ -77,6 +85,8 @@ using namespace std;
 
 #define DUMP_FUNC_MAP_SIZE      (sizeof(dump_func_map) / sizeof(DumpFuncMap))
 
+#define MAX_BITRATE_PROFILE_SECS    (7 * 24 * 60 * 60)
+
 
 
 typedef struct
@@ -93,6 +103,21 @@ typedef struct
     void (*dump)();
 } DumpFuncMap;
 
+typedef struct
+{
+    uint32_t type;
+    bool any_type;
+    uint32_t handler_type;
+    bool have_handler_type;
+} SelectSegment;
+
+typedef enum
+{
+    SELECT_SKIP,
+    SELECT_PARSE,
+    SELECT_DUMP,
+} SelectAction;
+
 
 static const uint32_t MHLR_COMPONENT_TYPE     = MKTAG("mhlr");
 static const uint32_t VIDE_COMPONENT_SUB_TYPE = MKTAG("vide");
@@ -101,6 +126,10 @@ static const uint32_t TMCD_COMPONENT_SUB_TYPE = MKTAG("tmcd");
 
 
 static FILE *g_mov_file = 0;
+static const unsigned char *g_mov_map = 0;
+static uint64_t g_mov_map_offset = 0;
+static uint64_t g_mov_map_size = 0;
+static unsigned char *g_moov_buffer = 0;
 static vector<MOVAtom> g_atoms;
 static uint64_t g_file_offset;
 static vector<string> g_meta_keys;
@@ -111,6 +140,20 @@ static bool g_qt_brand = true;
 static const char *g_avcc_filename = 0;
 static FILE *g_avcc_file = 0;
 static int mp4_object_desc_level = 0;
+static vector<vector<SelectSegment> > g_select_paths;
+static size_t g_selected_depth = 0;
+static uint32_t g_trak_handler_type = 0;
+static uint32_t g_sample_entry_type = 0;
+static bool g_full_detail = false;
+static uint32_t g_media_timescale = 0;
+static vector<uint32_t> g_stts_entries;
+static vector<uint32_t> g_stsc_entries;
+static uint32_t g_stsz_sample_size = 0;
+static uint32_t g_stsz_sample_count = 0;
+static vector<uint32_t> g_stsz_entries;
+static bool g_have_stts = false;
+static bool g_have_stsc = false;
+static bool g_have_stsz = false;
 
 
 class MOVException : public std::exception
@@ -166,6 +209,636 @@ protected:
 static uint32_t dump_mp4_object_descriptor(uint32_t length);
 
 
+// Output
+//
+// The dumpers write values using the typed emitters, e.g. out_field_uint(), out_uint() and dump_uint32(), which
+// format the text or write a JSON value under the key set by out_key(). Structure is written using
+// out_atom_begin(), out_object_begin(), out_array_begin() and the table and row helpers. The text-only labels and
+// padding are written using out_printf(), which writes nothing when the output is JSON.
+//
+// The output is appended to a large buffer that is written to stdout using writev, rather than using stdio. The
+// buffer is flushed after each line if stdout is a terminal.
+
+#define OUT_BUFFER_SIZE         (1024 * 1024)
+#define OUT_MIN_SPACE           1024    // flush if there is less space left before formatting text
+
+static char g_out_buffer[OUT_BUFFER_SIZE];
+static size_t g_out_size = 0;
+static bool g_out_line_buffered = false;
+static bool g_out_error = false;
+
+static const char DECIMAL_DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+
+// Writes the buffered output followed by <data>. The data is not copied into the buffer
+static void out_flush_data(const char *data, size_t size)
+{
+#if defined(_WIN32)
+    if (g_out_size > 0)
+        fwrite(g_out_buffer, 1, g_out_size, stdout);
+    if (size > 0)
+        fwrite(data, 1, size, stdout);
+    fflush(stdout);
+#else
+    struct iovec iov[2];
+    int iov_count = 0;
+    int iov_index = 0;
+
+    if (g_out_size > 0) {
+        iov[iov_count].iov_base = g_out_buffer;
+        iov[iov_count].iov_len  = g_out_size;
+        iov_count++;
+    }
+    if (size > 0) {
+        iov[iov_count].iov_base = (void*)data;
+        iov[iov_count].iov_len  = size;
+        iov_count++;
+    }
+
+    while (iov_index < iov_count && !g_out_error) {
+        ssize_t num_written = writev(STDOUT_FILENO, &iov[iov_index], iov_count - iov_index);
+        if (num_written < 0) {
+            if (errno == EINTR)
+                continue;
+            // the rest of the output is discarded, as printf would do
+            g_out_error = true;
+            break;
+        }
+
+        while (iov_index < iov_count && (size_t)num_written >= iov[iov_index].iov_len) {
+            num_written -= iov[iov_index].iov_len;
+            iov_index++;
+        }
+        if (iov_index < iov_count) {
+            iov[iov_index].iov_base = (char*)iov[iov_index].iov_base + num_written;
+            iov[iov_index].iov_len -= num_written;
+        }
+    }
+#endif
+
+    g_out_size = 0;
+}
+
+static void out_flush()
+{
+    out_flush_data(NULL, 0);
+}
+
+static void out_write(const char *data, size_t size)
+{
+    if (size > OUT_BUFFER_SIZE - g_out_size) {
+        if (size >= OUT_BUFFER_SIZE) {
+            out_flush_data(data, size);
+            return;
+        }
+        out_flush();
+    }
+
+    memcpy(&g_out_buffer[g_out_size], data, size);
+    g_out_size += size;
+
+    if (g_out_line_buffered && memchr(data, '\n', size))
+        out_flush();
+}
+
+static void out_write_char(char c)
+{
+    out_write(&c, 1);
+}
+
+static void out_write_string(const char *str)
+{
+    out_write(str, strlen(str));
+}
+
+
+// Text formatting of the printf conversions used by the dumpers, without the locale and with hand-rolled integer
+// conversions. The supported conversions are 'd', 'u', 'x', 'c', 's' and 'f', with an optional '0' flag for 'd',
+// 'u' and 'x', a width, a precision for 'f' and the 'l' and 'll' lengths used by the PRI*64 macros. Any other
+// conversion is rejected with an exception
+
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t len;     // length of the complete text, which may be larger than size
+} FormatBuffer;
+
+static void format_append(FormatBuffer *buffer, const char *data, size_t size)
+{
+    if (buffer->len < buffer->size) {
+        size_t copy_size = buffer->size - buffer->len;
+        if (copy_size > size)
+            copy_size = size;
+        memcpy(&buffer->data[buffer->len], data, copy_size);
+    }
+    buffer->len += size;
+}
+
+static void format_fill(FormatBuffer *buffer, char c, size_t count)
+{
+    if (buffer->len < buffer->size) {
+        size_t fill_size = buffer->size - buffer->len;
+        if (fill_size > count)
+            fill_size = count;
+        memset(&buffer->data[buffer->len], c, fill_size);
+    }
+    buffer->len += count;
+}
+
+// Writes the decimal or hex digits backwards from <end> and returns the number of digits
+static size_t convert_integer(char *end, uint64_t value, bool hex)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    char *digit = end;
+
+    if (hex) {
+        do {
+            *(--digit) = HEX_DIGITS[value & 0x0f];
+            value >>= 4;
+        } while (value);
+    } else {
+        while (value >= 100) {
+            const char *pair = &DECIMAL_DIGIT_PAIRS[(value % 100) * 2];
+            value /= 100;
+            *(--digit) = pair[1];
+            *(--digit) = pair[0];
+        }
+        if (value >= 10) {
+            *(--digit) = DECIMAL_DIGIT_PAIRS[value * 2 + 1];
+            *(--digit) = DECIMAL_DIGIT_PAIRS[value * 2];
+        } else {
+            *(--digit) = (char)('0' + value);
+        }
+    }
+
+    return end - digit;
+}
+
+static void format_integer(FormatBuffer *buffer, size_t width, bool zero_pad, uint64_t value, bool negative, bool hex)
+{
+    char digits[20];
+    size_t num_digits = convert_integer(&digits[sizeof(digits)], value, hex);
+    size_t len = num_digits + (negative ? 1 : 0);
+
+    if (!zero_pad && width > len)
+        format_fill(buffer, ' ', width - len);
+    if (negative)
+        format_append(buffer, "-", 1);
+    if (zero_pad && width > len)
+        format_fill(buffer, '0', width - len);
+    format_append(buffer, &digits[sizeof(digits) - num_digits], num_digits);
+}
+
+static void format_string(FormatBuffer *buffer, size_t width, const char *str, size_t len)
+{
+    if (width > len)
+        format_fill(buffer, ' ', width - len);
+    format_append(buffer, str, len);
+}
+
+static void format_double(FormatBuffer *buffer, int width, int precision, double value)
+{
+    char text[128];
+    int len;
+
+    len = snprintf(text, sizeof(text), "%*.*f", width, precision, value);
+    if (len < 0)
+        return;
+
+    if ((size_t)len < sizeof(text)) {
+        format_append(buffer, text, len);
+    } else {
+        vector<char> large_text(len + 1);
+        snprintf(&large_text[0], large_text.size(), "%*.*f", width, precision, value);
+        format_append(buffer, &large_text[0], len);
+    }
+}
+
+// Formats the text into <data> and returns the length of the complete text. Unlike vsnprintf, a null terminator
+// is not written and the text is truncated at <size>
+static size_t format_text(char *data, size_t size, const char *format, va_list varg)
+{
+    FormatBuffer buffer;
+    const char *literal;
+    const char *spec_start;
+    bool zero_pad;
+    int width;
+    int precision;
+    int num_longs;
+    char conversion;
+
+    buffer.data = data;
+    buffer.size = size;
+    buffer.len  = 0;
+
+    while (*format) {
+        literal = format;
+        while (*format && *format != '%')
+            format++;
+        if (format != literal)
+            format_append(&buffer, literal, format - literal);
+        if (!*format)
+            break;
+
+        spec_start = format++;
+
+        zero_pad = (*format == '0');
+        if (zero_pad)
+            format++;
+
+        width = 0;
+        if (*format == '*') {
+            width = va_arg(varg, int);
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9')
+                width = width * 10 + (*format++ - '0');
+        }
+
+        precision = -1;
+        if (*format == '.') {
+            format++;
+            precision = 0;
+            if (*format == '*') {
+                precision = va_arg(varg, int);
+                format++;
+            } else {
+                while (*format >= '0' && *format <= '9')
+                    precision = precision * 10 + (*format++ - '0');
+            }
+        }
+
+        num_longs = 0;
+        while (*format == 'l' && num_longs < 2) {
+            num_longs++;
+            format++;
+        }
+
+        conversion = *format;
+        if (conversion)
+            format++;
+
+        if (width < 0 ||
+            (precision >= 0 && conversion != 'f') ||
+            (zero_pad && conversion != 'd' && conversion != 'u' && conversion != 'x') ||
+            (num_longs > 0 && conversion != 'd' && conversion != 'u' && conversion != 'x'))
+        {
+            conversion = 0;
+        }
+
+        switch (conversion)
+        {
+            case 'd':
+            {
+                int64_t value;
+                if (num_longs == 2)
+                    value = va_arg(varg, long long);
+                else if (num_longs == 1)
+                    value = va_arg(varg, long);
+                else
+                    value = va_arg(varg, int);
+                format_integer(&buffer, width, zero_pad, (value < 0 ? -(uint64_t)value : (uint64_t)value),
+                               value < 0, false);
+                break;
+            }
+            case 'u':
+            case 'x':
+            {
+                uint64_t value;
+                if (num_longs == 2)
+                    value = va_arg(varg, unsigned long long);
+                else if (num_longs == 1)
+                    value = va_arg(varg, unsigned long);
+                else
+                    value = va_arg(varg, unsigned int);
+                format_integer(&buffer, width, zero_pad, value, false, conversion == 'x');
+                break;
+            }
+            case 'c':
+            {
+                char c = (char)va_arg(varg, int);
+                format_string(&buffer, width, &c, 1);
+                break;
+            }
+            case 's':
+            {
+                const char *str = va_arg(varg, const char*);
+                format_string(&buffer, width, str, strlen(str));
+                break;
+            }
+            case 'f':
+                format_double(&buffer, width, (precision >= 0 ? precision : 6), va_arg(varg, double));
+                break;
+            default:
+                throw MOVException("Unsupported output conversion '%.*s'", (int)(format - spec_start), spec_start);
+        }
+    }
+
+    return buffer.len;
+}
+
+static void out_vformat(const char *format, va_list varg)
+{
+    va_list varg_copy;
+    size_t space;
+    size_t len;
+
+    // the text is formatted directly into the output buffer if it fits
+    if (OUT_BUFFER_SIZE - g_out_size < OUT_MIN_SPACE)
+        out_flush();
+    space = OUT_BUFFER_SIZE - g_out_size;
+
+    va_copy(varg_copy, varg);
+    len = format_text(&g_out_buffer[g_out_size], space, format, varg_copy);
+    va_end(varg_copy);
+
+    if (len <= space) {
+        g_out_size += len;
+        if (g_out_line_buffered && len > 0 && memchr(&g_out_buffer[g_out_size - len], '\n', len))
+            out_flush();
+    } else {
+        vector<char> large_text(len);
+        format_text(&large_text[0], len, format, varg);
+        out_write(&large_text[0], len);
+    }
+}
+
+#if defined(__GNUC__)
+static void out_format(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#endif
+static void out_format(const char *format, ...)
+{
+    va_list varg;
+
+    va_start(varg, format);
+    out_vformat(format, varg);
+    va_end(varg);
+}
+
+
+// The JSON output is written directly by the dumpers' typed emitters: a value is a member of the enclosing object,
+// named by the pending key, or an element of the enclosing array. An atom is an object with its header values,
+// a "fields" object and a "children" array. The text-only decoration, e.g. the labels and padding, is not written
+typedef enum
+{
+    OUT_ATOM_LEVEL,
+    OUT_OBJECT_LEVEL,
+    OUT_ARRAY_LEVEL,
+    OUT_FIELDS_LEVEL,
+    OUT_CHILDREN_LEVEL,
+} OutLevelType;
+
+typedef struct
+{
+    OutLevelType type;
+    size_t atom_depth;
+    int extra_indent;
+    bool have_items;
+    bool have_children;
+} OutLevel;
+
+static bool g_json_output = false;
+static bool g_out_suppressed = false;
+static vector<OutLevel> g_out_levels;
+static const char *g_json_key = 0;
+
+
+static void json_string(const char *str, size_t len)
+{
+    size_t i;
+    out_write_char('"');
+    for (i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c == '"' || c == '\\') {
+            out_write_char('\\');
+            out_write_char(c);
+        } else if (c < 0x20 || c >= 0x7f) {
+            // characters >= 0x80, e.g. the 0xa9 prefix of international text atoms, are interpreted as Latin-1
+            out_format("\\u%04x", c);
+        } else {
+            out_write_char(c);
+        }
+    }
+    out_write_char('"');
+}
+
+static void push_out_level(OutLevelType type, int extra_indent)
+{
+    OutLevel level;
+    level.type = type;
+    level.atom_depth = g_atoms.size();
+    level.extra_indent = extra_indent;
+    level.have_items = false;
+    level.have_children = false;
+    g_out_levels.push_back(level);
+}
+
+static void pop_out_level()
+{
+    if (g_json_output) {
+        if (g_out_levels.back().type == OUT_ARRAY_LEVEL || g_out_levels.back().type == OUT_CHILDREN_LEVEL)
+            out_write_char(']');
+        else
+            out_write_char('}');
+    }
+    g_out_levels.pop_back();
+}
+
+static void json_item_start()
+{
+    if (g_out_levels.back().have_items)
+        out_write_char(',');
+    g_out_levels.back().have_items = true;
+}
+
+// Starts a value in the enclosing object or array. The fields of an atom are collected in its "fields" object
+// and a field following the child atoms, e.g. the size of unparsed data, is a member of the atom object
+static void json_value_start()
+{
+    if (g_out_levels.back().type == OUT_CHILDREN_LEVEL)
+        pop_out_level();
+    if (g_out_levels.back().type == OUT_ATOM_LEVEL && !g_out_levels.back().have_children) {
+        json_item_start();
+        out_write_string("\"fields\":{");
+        push_out_level(OUT_FIELDS_LEVEL, g_out_levels.back().extra_indent);
+    }
+
+    json_item_start();
+    if (g_out_levels.back().type != OUT_ARRAY_LEVEL) {
+        const char *key = (g_json_key ? g_json_key : "value");
+        json_string(key, strlen(key));
+        out_write_char(':');
+    }
+    g_json_key = 0;
+}
+
+// Starts an atom in the "children" array of the enclosing atom or object
+static void json_atom_start()
+{
+    if (g_out_levels.back().type == OUT_FIELDS_LEVEL)
+        pop_out_level();
+    if (g_out_levels.back().type == OUT_ATOM_LEVEL || g_out_levels.back().type == OUT_OBJECT_LEVEL) {
+        json_item_start();
+        out_write_string("\"children\":[");
+        g_out_levels.back().have_children = true;
+        push_out_level(OUT_CHILDREN_LEVEL, 0);
+    }
+
+    json_item_start();
+    out_write_char('\n');
+}
+
+#if defined(__GNUC__)
+static void out_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#endif
+// Writes formatted text, which is not part of the JSON output
+static void out_printf(const char *format, ...)
+{
+    va_list varg;
+
+    if (g_out_suppressed || g_json_output)
+        return;
+
+    va_start(varg, format);
+    out_vformat(format, varg);
+    va_end(varg);
+}
+
+// Writes text that doesn't require formatting
+static void out_text(const char *text, size_t size)
+{
+    if (g_out_suppressed || g_json_output)
+        return;
+
+    out_write(text, size);
+}
+
+static void out_spaces(size_t count)
+{
+    static const char SPACES[] = "                                                                ";
+
+    while (count > sizeof(SPACES) - 1) {
+        out_text(SPACES, sizeof(SPACES) - 1);
+        count -= sizeof(SPACES) - 1;
+    }
+    out_text(SPACES, count);
+}
+
+// Sets the key of the next JSON value. The key must be a string literal
+static void out_key(const char *key)
+{
+    g_json_key = key;
+}
+
+static void out_atom_begin(const char *type, uint64_t size, uint64_t offset)
+{
+    if (g_json_output) {
+        json_atom_start();
+        out_write_string("{\"type\":");
+        json_string(type, 4);
+        out_format(",\"size\":%" PRIu64 ",\"offset\":%" PRIu64, size, offset);
+    }
+
+    push_out_level(OUT_ATOM_LEVEL, 0);
+    g_out_levels.back().have_items = true;
+}
+
+// Completes the current atom. The atom has no output level if it was not selected
+static void out_atom_end()
+{
+    size_t atom_depth = g_atoms.size();
+    size_t i = g_out_levels.size();
+    while (i > 0 && !(g_out_levels[i - 1].type == OUT_ATOM_LEVEL && g_out_levels[i - 1].atom_depth == atom_depth))
+        i--;
+    if (i == 0)
+        return;
+
+    while (g_out_levels.size() >= i)
+        pop_out_level();
+}
+
+// Begins an object whose fields are indented by <extra_indent_amount> in the text output
+static void out_object_begin(const char *key = 0, int extra_indent_amount = 0)
+{
+    if (g_out_suppressed)
+        return;
+
+    if (g_json_output) {
+        if (key)
+            g_json_key = key;
+        json_value_start();
+        out_write_char('{');
+    }
+    push_out_level(OUT_OBJECT_LEVEL, extra_indent_amount);
+}
+
+static void out_object_end()
+{
+    if (g_out_suppressed)
+        return;
+
+    while (g_out_levels.back().type != OUT_OBJECT_LEVEL)
+        pop_out_level();
+    pop_out_level();
+}
+
+static void out_array_begin(const char *key = 0, int extra_indent_amount = 0)
+{
+    if (g_out_suppressed)
+        return;
+
+    if (g_json_output) {
+        if (key)
+            g_json_key = key;
+        json_value_start();
+        out_write_char('[');
+    }
+    push_out_level(OUT_ARRAY_LEVEL, extra_indent_amount);
+}
+
+static void out_array_end()
+{
+    if (g_out_suppressed)
+        return;
+
+    while (g_out_levels.back().type != OUT_ARRAY_LEVEL)
+        pop_out_level();
+    pop_out_level();
+}
+
+static void out_begin()
+{
+    if (g_json_output) {
+        out_write_char('[');
+        push_out_level(OUT_ARRAY_LEVEL, 0);
+    }
+}
+
+// Completes the JSON output, including when dumping was stopped by an exception
+static void out_end()
+{
+    if (g_json_output) {
+        while (g_out_levels.size() > 1)
+            pop_out_level();
+        g_out_levels.clear();
+        out_write_string("\n]\n");
+    }
+
+    out_flush();
+}
+
+
 static bool equals_type(const char *left, const char *right)
 {
     return memcmp(left, right, 4) == 0;
@@ -182,6 +855,11 @@ static void update_atom_read(uint64_t num_read)
 
 static void skip_bytes(uint64_t num_bytes)
 {
+    if (g_mov_map) {
+        update_atom_read(num_bytes);
+        return;
+    }
+
 #if defined(_WIN32)
     MOV_CHECK(_fseeki64(g_mov_file, num_bytes, SEEK_CUR) == 0);
 #else
@@ -202,14 +880,51 @@ static void pop_atom()
     MOV_CHECK(!g_atoms.empty());
     MOV_CHECK(CURRENT_ATOM.rem_size == 0);
 
+    out_atom_end();
+
     if (g_atoms.size() > 1)
         PREV_ATOM.rem_size -= CURRENT_ATOM.size;
 
     g_atoms.pop_back();
 }
 
+// Returns a pointer to the next <size> bytes in the file mapping, or reads them into <buffer> if the file is not mapped.
+// The mapping is either the whole file or the 'moov' atom data loaded in the moov-only mode
+static const unsigned char* read_data(unsigned char *buffer, uint32_t size)
+{
+    if (g_mov_map) {
+        if (g_file_offset < g_mov_map_offset ||
+            g_file_offset - g_mov_map_offset > g_mov_map_size ||
+            size > g_mov_map_size - (g_file_offset - g_mov_map_offset))
+        {
+            return 0;
+        }
+
+        const unsigned char *data = &g_mov_map[g_file_offset - g_mov_map_offset];
+        update_atom_read(size);
+        return data;
+    }
+
+    if (fread(buffer, 1, size, g_mov_file) != size) {
+        if (ferror(g_mov_file))
+            throw MOVException("Failed to read bytes: %s", strerror(errno));
+        return 0;
+    }
+
+    update_atom_read(size);
+    return buffer;
+}
+
 static bool read_bytes(unsigned char *bytes, uint32_t size)
 {
+    if (g_mov_map) {
+        const unsigned char *data = read_data(bytes, size);
+        if (!data)
+            return false;
+        memcpy(bytes, data, size);
+        return true;
+    }
+
     if (fread(bytes, 1, size, g_mov_file) != size) {
         if (ferror(g_mov_file))
             throw MOVException("Failed to read bytes: %s", strerror(errno));
@@ -222,8 +937,9 @@ static bool read_bytes(unsigned char *bytes, uint32_t size)
 
 static bool read_uint64(uint64_t *value)
 {
-    unsigned char bytes[8];
-    if (!read_bytes(bytes, 8))
+    unsigned char buffer[8];
+    const unsigned char *bytes = read_data(buffer, 8);
+    if (!bytes)
         return false;
 
     *value = (((uint64_t)bytes[0]) << 56) |
@@ -250,8 +966,9 @@ static bool read_int64(int64_t *value)
 
 static bool read_uint32(uint32_t *value)
 {
-    unsigned char bytes[4];
-    if (!read_bytes(bytes, 4))
+    unsigned char buffer[4];
+    const unsigned char *bytes = read_data(buffer, 4);
+    if (!bytes)
         return false;
 
     *value = (((uint32_t)bytes[0]) << 24) |
@@ -274,8 +991,9 @@ static bool read_int32(int32_t *value)
 
 static bool read_uint24(uint32_t *value)
 {
-    unsigned char bytes[3];
-    if (!read_bytes(bytes, 3))
+    unsigned char buffer[3];
+    const unsigned char *bytes = read_data(buffer, 3);
+    if (!bytes)
         return false;
 
     *value = (((uint32_t)bytes[0]) << 16) |
@@ -297,8 +1015,9 @@ static bool read_int24(int32_t *value)
 
 static bool read_uint16(uint16_t *value)
 {
-    unsigned char bytes[2];
-    if (!read_bytes(bytes, 2))
+    unsigned char buffer[2];
+    const unsigned char *bytes = read_data(buffer, 2);
+    if (!bytes)
         return false;
 
     *value = (((uint16_t)bytes[0]) << 8) |
@@ -319,8 +1038,9 @@ static bool read_int16(int16_t *value)
 
 static bool read_uint8(uint8_t *value)
 {
-    unsigned char bytes[1];
-    if (!read_bytes(bytes, 1))
+    unsigned char buffer[1];
+    const unsigned char *bytes = read_data(buffer, 1);
+    if (!bytes)
         return false;
 
     *value = bytes[0];
@@ -338,12 +1058,52 @@ static bool read_int8(int8_t *value)
     return true;
 }
 
-static void write_avcc_ps(unsigned char **buffer, size_t *buffer_size, uint8_t length_size, uint16_t ps_size)
-{
-    if (!g_avcc_file) {
-        g_avcc_file = fopen(g_avcc_filename, "wb");
-        if (!g_avcc_file)
-            throw MOVException("Failed to open avcc file '%s': %s", g_avcc_filename, strerror(errno));
+// Reads <count> big-endian values and decodes them in bulk. The values are decoded directly from the file mapping
+// or else read in blocks
+static void read_uint32_array(uint32_t *values, size_t count)
+{
+    vector<unsigned char> buffer;
+    size_t max_block_count = (g_mov_map ? UINT32_MAX / 4 : 65536);
+    size_t i = 0;
+    while (i < count) {
+        size_t block_count = count - i;
+        if (block_count > max_block_count)
+            block_count = max_block_count;
+        if (!g_mov_map)
+            buffer.resize(block_count * 4);
+        const unsigned char *bytes = read_data((buffer.empty() ? 0 : &buffer[0]), (uint32_t)(block_count * 4));
+        MOV_CHECK(bytes);
+
+        be_decode_uint32(&values[i], bytes, block_count);
+        i += block_count;
+    }
+}
+
+static void read_uint64_array(uint64_t *values, size_t count)
+{
+    vector<unsigned char> buffer;
+    size_t max_block_count = (g_mov_map ? UINT32_MAX / 8 : 32768);
+    size_t i = 0;
+    while (i < count) {
+        size_t block_count = count - i;
+        if (block_count > max_block_count)
+            block_count = max_block_count;
+        if (!g_mov_map)
+            buffer.resize(block_count * 8);
+        const unsigned char *bytes = read_data((buffer.empty() ? 0 : &buffer[0]), (uint32_t)(block_count * 8));
+        MOV_CHECK(bytes);
+
+        be_decode_uint64(&values[i], bytes, block_count);
+        i += block_count;
+    }
+}
+
+static void write_avcc_ps(unsigned char **buffer, size_t *buffer_size, uint8_t length_size, uint16_t ps_size)
+{
+    if (!g_avcc_file) {
+        g_avcc_file = fopen(g_avcc_filename, "wb");
+        if (!g_avcc_file)
+            throw MOVException("Failed to open avcc file '%s': %s", g_avcc_filename, strerror(errno));
     }
 
     unsigned char length_bytes[4];
@@ -494,98 +1254,314 @@ static double get_duration_sec(int64_t duration, uint32_t timescale)
 
 static void indent_atom_header()
 {
-    size_t i;
-    for (i = 1; i < g_atoms.size(); i++)
-        printf(ATOM_INDENT);
+    if (g_atoms.size() > 1)
+        out_spaces((g_atoms.size() - 1) * (sizeof(ATOM_INDENT) - 1));
 }
 
 static void indent(int extra_amount = 0)
 {
-    int i;
-    for (i = 1; i < (int)g_atoms.size(); i++)
-        printf(ATOM_INDENT);
-    printf(ATOM_VALUE_INDENT);
-    for (i = 0; i < extra_amount; i++)
-        printf(" ");
+    size_t count = (sizeof(ATOM_VALUE_INDENT) - 1) + (extra_amount > 0 ? extra_amount : 0);
+    if (g_atoms.size() > 1)
+        count += (g_atoms.size() - 1) * (sizeof(ATOM_INDENT) - 1);
+    out_spaces(count);
+}
+
+static void json_uint_value(uint64_t value)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    out_format("%" PRIu64, value);
+}
+
+static void json_int_value(int64_t value)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    out_format("%" PRId64, value);
+}
+
+static void json_double_value(double value, int precision)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    if (value - value == 0.0) // false for infinity and NaN, which JSON can't represent
+        out_format("%.*f", precision, value);
+    else
+        out_write_string("null");
+}
+
+static void json_string_value(const char *str, size_t len)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    json_string(str, len);
+}
+
+static void json_bool_value(bool value)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    out_write_string(value ? "true" : "false");
+}
+
+static void json_hex_bytes(const unsigned char *bytes, size_t size)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    size_t i;
+    for (i = 0; i < size; i++) {
+        out_write_char(HEX_DIGITS[bytes[i] >> 4]);
+        out_write_char(HEX_DIGITS[bytes[i] & 0x0f]);
+    }
+}
+
+static void json_bytes_value(const unsigned char *bytes, size_t size)
+{
+    if (g_out_suppressed)
+        return;
+
+    json_value_start();
+    out_write_char('"');
+    json_hex_bytes(bytes, size);
+    out_write_char('"');
+}
+
+static void out_uint(uint64_t value, int width = 0)
+{
+    if (g_json_output)
+        json_uint_value(value);
+    else
+        out_printf("%*" PRIu64, width, value);
+}
+
+static void out_int(int64_t value, int width = 0)
+{
+    if (g_json_output)
+        json_int_value(value);
+    else
+        out_printf("%*" PRId64, width, value);
+}
+
+static void out_hex(uint64_t value, int num_digits, const char *prefix = "0x")
+{
+    if (g_json_output)
+        json_uint_value(value);
+    else
+        out_printf("%s%0*" PRIx64, prefix, num_digits, value);
+}
+
+static void out_double(double value, int precision = 6)
+{
+    if (g_json_output)
+        json_double_value(value, precision);
+    else
+        out_printf("%.*f", precision, value);
+}
+
+static void out_bool(bool value)
+{
+    if (g_json_output)
+        json_bool_value(value);
+    else
+        out_printf("%s", value ? "yes" : "no");
+}
+
+static void out_string(const char *str)
+{
+    if (g_json_output)
+        json_string_value(str, strlen(str));
+    else
+        out_text(str, strlen(str));
+}
+
+static int get_field_indent()
+{
+    return g_out_levels.empty() ? 0 : g_out_levels.back().extra_indent;
+}
+
+// Begins a "<name>: " line. The JSON key is <name> unless a <key> is given, e.g. when <name> is not unique
+static void out_field_begin(const char *name, const char *key = 0)
+{
+    if (g_json_output) {
+        out_key(key ? key : name);
+        return;
+    }
+
+    indent(get_field_indent());
+    out_text(name, strlen(name));
+    out_text(": ", 2);
+}
+
+static void out_field_end()
+{
+    out_text("\n", 1);
+}
+
+// Begins the <key> array of table rows and writes the text line with the column names
+static void out_table_begin(const char *key, uint64_t num_entries, const char *columns, int extra_indent_amount = 4)
+{
+    out_array_begin(key, extra_indent_amount);
+
+    indent(extra_indent_amount);
+    if (num_entries < 0xffff)
+        out_printf("   i");
+    else if (num_entries < 0xffffff)
+        out_printf("     i");
+    else
+        out_printf("       i");
+    out_printf("%s\n", columns);
+}
+
+static void out_table_end()
+{
+    out_array_end();
+}
+
+// Begins a table row object. The row index is text only
+static void out_row_begin(uint64_t num_entries, uint64_t index)
+{
+    if (g_out_suppressed)
+        return;
+
+    if (g_json_output) {
+        json_value_start();
+        out_write_string("\n{");
+    } else {
+        indent(get_field_indent());
+        if (num_entries < 0xffff)
+            out_printf("%04" PRIx64 "  ", index);
+        else if (num_entries < 0xffffff)
+            out_printf("%06" PRIx64 "  ", index);
+        else if (num_entries < 0xffffffff)
+            out_printf("%08" PRIx64 "  ", index);
+        else
+            out_printf("%016" PRIx64 "  ", index);
+    }
+    push_out_level(OUT_OBJECT_LEVEL, get_field_indent());
+}
+
+static void out_row_end()
+{
+    if (g_out_suppressed)
+        return;
+
+    out_text("\n", 1);
+    pop_out_level();
 }
 
 static void dump_uint64_index(uint64_t count, uint64_t index)
 {
     if (count < 0xffff)
-        printf("%04" PRIx64, index);
+        out_printf("%04" PRIx64, index);
     else if (count < 0xffffff)
-        printf("%06" PRIx64, index);
+        out_printf("%06" PRIx64, index);
     else if (count < 0xffffffff)
-        printf("%08" PRIx64, index);
+        out_printf("%08" PRIx64, index);
     else
-        printf("%016" PRIx64, index);
+        out_printf("%016" PRIx64, index);
 }
 
 static void dump_uint32_index(uint32_t count, uint32_t index)
 {
     if (count < 0xffff)
-        printf("%04x", index);
+        out_printf("%04x", index);
     else if (count < 0xffffff)
-        printf("%06x", index);
+        out_printf("%06x", index);
     else
-        printf("%08x", index);
+        out_printf("%08x", index);
 }
 
 static void dump_uint16_index(uint16_t count, uint16_t index)
 {
     if (count < 0xff)
-        printf("%02x", index);
+        out_printf("%02x", index);
     else
-        printf("%04x", index);
+        out_printf("%04x", index);
 }
 
 static void dump_inline_bytes(unsigned char *bytes, uint32_t size)
 {
-    printf("(size %u) ", size);
+    if (g_json_output) {
+        json_bytes_value(bytes, size);
+        return;
+    }
+
+    out_printf("(size %u) ", size);
 
     uint32_t i;
     for (i = 0; i < size; i++)
-        printf(" %02x", bytes[i]);
+        out_printf(" %02x", bytes[i]);
 
-    printf("  |");
+    out_printf("  |");
     for (i = 0; i < size; i++) {
         if (isprint(bytes[i]))
-            printf("%c", bytes[i]);
+            out_printf("%c", bytes[i]);
         else
-            printf(".");
+            out_printf(".");
     }
-    printf("|");
+    out_printf("|");
 }
 
 static void dump_bytes_line(uint64_t size, uint64_t offset, unsigned char *line, uint32_t line_size)
 {
     dump_uint64_index(size, offset);
-    printf("  ");
+    out_printf("  ");
 
     uint32_t i;
     for (i = 0; i < line_size; i++) {
         if (i == 8)
-            printf(" ");
-        printf(" %02x", line[i]);
+            out_printf(" ");
+        out_printf(" %02x", line[i]);
     }
     for (; i < 16; i++) {
         if (i == 8)
-            printf(" ");
-        printf("   ");
+            out_printf(" ");
+        out_printf("   ");
     }
 
-    printf("  |");
+    out_printf("  |");
     for (i = 0; i < line_size; i++) {
         if (isprint(line[i]))
-            printf("%c", line[i]);
+            out_printf("%c", line[i]);
         else
-            printf(".");
+            out_printf(".");
     }
-    printf("|");
+    out_printf("|");
 }
 
+// Reads and dumps <size> bytes, which are a hex string value in the JSON output
 static void dump_bytes(uint64_t size, int extra_indent_amount = 0)
 {
+    if (g_json_output) {
+        unsigned char buffer[4096];
+        uint32_t num_read;
+
+        if (!g_out_suppressed) {
+            json_value_start();
+            out_write_char('"');
+        }
+        while (size > 0) {
+            num_read = (size > sizeof(buffer) ? (uint32_t)sizeof(buffer) : (uint32_t)size);
+            MOV_CHECK(read_bytes(buffer, num_read));
+            if (!g_out_suppressed)
+                json_hex_bytes(buffer, num_read);
+            size -= num_read;
+        }
+        if (!g_out_suppressed)
+            out_write_char('"');
+        return;
+    }
+
     if (size == 0)
         return;
 
@@ -602,7 +1578,7 @@ static void dump_bytes(uint64_t size, int extra_indent_amount = 0)
         MOV_CHECK(read_bytes(buffer, num_read));
 
         if (total_read > 0) {
-            printf("\n");
+            out_printf("\n");
             indent(extra_indent_amount);
         }
 
@@ -611,18 +1587,23 @@ static void dump_bytes(uint64_t size, int extra_indent_amount = 0)
         total_read += num_read;
     }
 
-    printf("\n");
+    out_printf("\n");
 }
 
 static void dump_bytes(unsigned char *bytes, uint64_t size, int extra_indent_amount = 0)
 {
+    if (g_json_output) {
+        json_bytes_value(bytes, (size_t)size);
+        return;
+    }
+
     indent(extra_indent_amount);
 
     uint64_t num_lines = size / 16;
     uint64_t i;
     for (i = 0; i < num_lines; i++) {
         if (i > 0) {
-            printf("\n");
+            out_printf("\n");
             indent(extra_indent_amount);
         }
 
@@ -630,25 +1611,28 @@ static void dump_bytes(unsigned char *bytes, uint64_t size, int extra_indent_amo
     }
 
     if (num_lines > 0)
-        printf("\n");
+        out_printf("\n");
 
     if ((size % 16) > 0) {
         if (num_lines > 0)
             indent(extra_indent_amount);
         dump_bytes_line(size, num_lines * 16, &bytes[num_lines * 16], (uint32_t)(size % 16));
-        printf("\n");
+        out_printf("\n");
     }
 }
 
+// Reads and dumps a string value followed by a newline. The string is dumped as bytes if it is not printable
 static void dump_string(uint64_t size, int extra_indent_amount = 0)
 {
     if (size == 0) {
-        printf("\n");
+        if (g_json_output)
+            json_string_value("", 0);
+        out_printf("\n");
         return;
     }
 
     if (size > 256) {
-        printf("\n");
+        out_printf("\n");
         indent(extra_indent_amount);
         dump_bytes(size, extra_indent_amount);
         return;
@@ -668,120 +1652,175 @@ static void dump_string(uint64_t size, int extra_indent_amount = 0)
                 break;
         }
         if (i < size) {
-            printf("\n");
+            out_printf("\n");
             dump_bytes(buffer, size, extra_indent_amount);
             return;
         }
     }
 
-    printf("'");
+    if (g_json_output) {
+        for (i = 0; i < size; i++) {
+            if (buffer[i] == '\0')
+                break;
+        }
+        json_string_value((const char*)buffer, (size_t)i);
+        return;
+    }
+
+    out_printf("'");
     for (i = 0; i < size; i++) {
         if (buffer[i] == '\0')
             break;
 
-        printf("%c", buffer[i]);
+        out_printf("%c", buffer[i]);
     }
-    printf("'");
+    out_printf("'");
     if (i < size) {
-        printf(" +");
+        out_printf(" +");
         for (; i < size; i++)
-            printf(" 0x00");
+            out_printf(" 0x00");
     }
-    printf("\n");
+    out_printf("\n");
 }
 
 static void dump_type(const char *type)
 {
+    if (g_json_output) {
+        json_string_value(type, 4);
+        return;
+    }
+
     size_t i;
     for (i = 0; i < 4; i++)
-        printf("%c", type[i]);
+        out_printf("%c", type[i]);
+}
+
+static void json_uint32_chars_value(uint32_t value)
+{
+    char chars[4];
+    int i;
+    for (i = 0; i < 4; i++)
+        chars[i] = (char)((value >> (8 * (3 - i))) & 0xff);
+    json_string_value(chars, 4);
 }
 
 static void dump_uint32_tag(uint32_t value)
 {
+    if (g_json_output) {
+        json_uint32_chars_value(value);
+        return;
+    }
+
     int i;
     for (i = 3; i >= 0; i--)
-        printf("%c", (value >> (8 * i)) & 0xff);
+        out_printf("%c", (value >> (8 * i)) & 0xff);
 }
 
 static void dump_file_size(uint64_t value)
 {
-    if (value > UINT32_MAX)
-        printf("%20" PRIu64 " (0x%016" PRIx64 ")", value, value);
+    if (g_json_output)
+        json_uint_value(value);
+    else if (value > UINT32_MAX)
+        out_printf("%20" PRIu64 " (0x%016" PRIx64 ")", value, value);
     else
-        printf("%10u (0x%08x)", (uint32_t)value, (uint32_t)value);
+        out_printf("%10u (0x%08x)", (uint32_t)value, (uint32_t)value);
 }
 
 static void dump_uint64_size(uint64_t value)
 {
-    printf("%20" PRIu64 " (0x%016" PRIx64 ")", value, value);
+    if (g_json_output)
+        json_uint_value(value);
+    else
+        out_printf("%20" PRIu64 " (0x%016" PRIx64 ")", value, value);
 }
 
 static void dump_uint32_size(uint32_t value)
 {
-    printf("%10u (0x%08x)", value, value);
+    if (g_json_output)
+        json_uint_value(value);
+    else
+        out_printf("%10u (0x%08x)", value, value);
 }
 
 static void dump_uint64(uint64_t value, bool hex)
 {
-    if (hex)
-        printf("0x%016" PRIx64, value);
+    if (g_json_output)
+        json_uint_value(value);
+    else if (hex)
+        out_printf("0x%016" PRIx64, value);
     else
-        printf("%20" PRIu64, value);
+        out_printf("%20" PRIu64, value);
 }
 
 static void dump_int64(int64_t value)
 {
-    printf("%20" PRId64, value);
+    if (g_json_output)
+        json_int_value(value);
+    else
+        out_printf("%20" PRId64, value);
 }
 
 static void dump_uint32(uint32_t value, bool hex)
 {
-    if (hex)
-        printf("0x%08x", value);
+    if (g_json_output)
+        json_uint_value(value);
+    else if (hex)
+        out_printf("0x%08x", value);
     else
-        printf("%10u", value);
+        out_printf("%10u", value);
 }
 
 static void dump_int32(uint32_t value)
 {
-    printf("%10d", value);
+    if (g_json_output)
+        json_int_value((int32_t)value);
+    else
+        out_printf("%10d", value);
 }
 
 static void dump_uint16(uint16_t value, bool hex)
 {
-    if (hex)
-        printf("0x%04x", value);
+    if (g_json_output)
+        json_uint_value(value);
+    else if (hex)
+        out_printf("0x%04x", value);
     else
-        printf("%5u", value);
+        out_printf("%5u", value);
 }
 
 static void dump_uint8(uint8_t value, bool hex)
 {
-    if (hex)
-        printf("0x%02x", value);
+    if (g_json_output)
+        json_uint_value(value);
+    else if (hex)
+        out_printf("0x%02x", value);
     else
-        printf("%3u", value);
+        out_printf("%3u", value);
 }
 
 static void dump_uint32_chars(uint32_t value)
 {
+    if (g_json_output) {
+        json_uint32_chars_value(value);
+        return;
+    }
+
     int i;
     for (i = 3; i >= 0; i--) {
         unsigned char c = (value >> (8 * i)) & 0xff;
         if (isprint(c))
-            printf("%c", c);
+            out_printf("%c", c);
         else
-            printf(".");
+            out_printf(".");
     }
-    printf(" (");
+    out_printf(" (");
     for (i = 3; i >= 0; i--) {
         unsigned char c = (value >> (8 * i)) & 0xff;
         if (i != 3)
-            printf(" ");
-        printf("%02x", c);
+            out_printf(" ");
+        out_printf("%02x", c);
     }
-    printf(")");
+    out_printf(")");
 }
 
 static void dump_language(uint16_t value)
@@ -790,112 +1829,452 @@ static void dump_language(uint16_t value)
     unsigned char letter_2 = (unsigned char)((value >> 5)  & 0x1f);
     unsigned char letter_3 = (unsigned char)( value        & 0x1f);
 
-    if (letter_1 >= 1 && letter_1 <= 26 &&
-        letter_2 >= 1 && letter_2 <= 26 &&
-        letter_3 >= 1 && letter_3 <= 26)
+    if (g_json_output)
     {
-        printf("0x%04x (%c%c%c)", value, letter_1 + 0x60, letter_2 + 0x60, letter_3 + 0x60);
+        json_uint_value(value);
+    }
+    else if (letter_1 >= 1 && letter_1 <= 26 &&
+             letter_2 >= 1 && letter_2 <= 26 &&
+             letter_3 >= 1 && letter_3 <= 26)
+    {
+        out_printf("0x%04x (%c%c%c)", value, letter_1 + 0x60, letter_2 + 0x60, letter_3 + 0x60);
     }
     else
     {
-        printf("0x%04x", value);
+        out_printf("0x%04x", value);
+    }
+}
+
+static void dump_uint32_fp(uint32_t value, uint8_t bits_left)
+{
+    out_double(value / (double)(1 << (32 - bits_left)));
+}
+
+static void dump_uint16_fp(uint16_t value, uint8_t bits_left)
+{
+    out_double(value / (double)(1 << (16 - bits_left)));
+}
+
+static void dump_int16_fp(int16_t value, uint8_t bits_left)
+{
+    out_double(value / (double)(1 << (16 - bits_left)));
+}
+
+// Dumps a date and time, which is the number of seconds since 1904-01-01 in the JSON output
+static void dump_timestamp(uint64_t value)
+{
+    if (g_json_output) {
+        json_uint_value(value);
+        return;
+    }
+
+    // 2082844800 = difference between Unix epoch (1970-01-01) and Apple epoch (1904-01-01)
+    time_t unix_secs = (time_t)(value - 2082844800);
+    struct tm *utc;
+    utc = gmtime(&unix_secs);
+    if (utc == 0) {
+        out_printf("%" PRIu64 " seconds since 1904-01-01", value);
+    } else {
+        out_printf("%04d-%02d-%02dT%02d:%02d:%02dZ (%" PRIu64 " sec since 1904-01-01)",
+               utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday,
+               utc->tm_hour, utc->tm_min, utc->tm_sec,
+               value);
+    }
+}
+
+// Dumps the matrix rows, which is an array of 3 row arrays in the JSON output
+static void dump_matrix(uint32_t *matrix, int extra_indent_amount = 0)
+{
+    // matrix:
+    //    a  b  u
+    //    c  d  v
+    //    tx ty w
+    //
+    // order is: a, b, u, c, d, v, tx, ty, w
+    // all are fixed point 16.16, except u, v and w which are 2.30, hence w = 0x40000000 (1.0)
+
+    int i, j;
+    out_array_begin();
+    for (i = 0; i < 3; i++) {
+        indent(extra_indent_amount);
+        out_array_begin();
+        for (j = 0; j < 3; j++) {
+            if (j != 0)
+                out_printf(" ");
+            if (j == 2)
+                dump_uint32_fp(matrix[i * 3 + j], 2);
+            else
+                dump_uint32_fp(matrix[i * 3 + j], 16);
+        }
+        out_array_end();
+        out_printf("\n");
+    }
+    out_array_end();
+}
+
+static void dump_color(uint16_t red, uint16_t green, uint16_t blue)
+{
+    if (g_json_output) {
+        out_object_begin();
+        out_key("red");
+        json_uint_value(red);
+        out_key("green");
+        json_uint_value(green);
+        out_key("blue");
+        json_uint_value(blue);
+        out_object_end();
+        return;
+    }
+
+    out_printf("RGB(0x%04x,0x%04x,0x%04x)", red, green, blue);
+}
+
+static void dump_fragment_sample_flags(uint32_t flags)
+{
+    if (g_json_output) {
+        out_object_begin();
+        out_key("res");
+        json_uint_value((flags >> 28) &   0x0f);
+        out_key("lead");
+        json_uint_value((flags >> 26) &   0x03);
+        out_key("deps_on");
+        json_uint_value((flags >> 24) &   0x03);
+        out_key("depd_on");
+        json_uint_value((flags >> 22) &   0x03);
+        out_key("red");
+        json_uint_value((flags >> 20) &   0x03);
+        out_key("pad");
+        json_uint_value((flags >> 17) &   0x07);
+        out_key("nsync");
+        json_uint_value((flags >> 16) &   0x01);
+        out_key("priority");
+        json_uint_value( flags        & 0xffff);
+        out_object_end();
+        return;
+    }
+
+    out_printf("res=0x%x, ",       (flags >> 28) &   0x0f);
+    out_printf("lead=0x%x, ",      (flags >> 26) &   0x03);
+    out_printf("deps_on=0x%x, ",   (flags >> 24) &   0x03);
+    out_printf("depd_on=0x%x, ",   (flags >> 22) &   0x03);
+    out_printf("red=0x%x, ",       (flags >> 20) &   0x03);
+    out_printf("pad=0x%x, ",       (flags >> 17) &   0x07);
+    out_printf("nsync=0x%x, ",     (flags >> 16) &   0x01);
+    out_printf("priority=0x%04x",   flags        & 0xffff);
+}
+
+static void out_field_uint(const char *name, uint64_t value)
+{
+    out_field_begin(name);
+    out_uint(value);
+    out_field_end();
+}
+
+static void out_field_int(const char *name, int64_t value)
+{
+    out_field_begin(name);
+    out_int(value);
+    out_field_end();
+}
+
+static void out_field_hex(const char *name, uint64_t value, int num_digits)
+{
+    out_field_begin(name);
+    out_hex(value, num_digits);
+    out_field_end();
+}
+
+static void out_field_fourcc(const char *name, uint32_t value)
+{
+    out_field_begin(name);
+    dump_uint32_chars(value);
+    out_field_end();
+}
+
+// Writes a duration in <timescale> units. The duration in seconds is text only
+static void out_field_duration(const char *name, int64_t duration, uint32_t timescale)
+{
+    out_field_begin(name);
+    out_int(duration);
+    out_printf(" (%f sec)", get_duration_sec(duration, timescale));
+    out_field_end();
+}
+
+// Writes a fragment sample flags value followed by its decoded fields
+static void out_field_sample_flags(const char *name, const char *fields_key, uint32_t flags)
+{
+    out_field_begin(name);
+    out_hex(flags, 8);
+    out_printf(" (");
+    out_key(fields_key);
+    dump_fragment_sample_flags(flags);
+    out_printf(")");
+    out_field_end();
+}
+
+static void dump_atom_header()
+{
+    if (g_out_suppressed)
+        return;
+
+    out_atom_begin(CURRENT_ATOM.type, CURRENT_ATOM.size, CURRENT_ATOM.offset);
+    if (g_json_output)
+        return;
+
+    indent_atom_header();
+    dump_type(CURRENT_ATOM.type);
+    out_printf(": s=");
+    dump_file_size(CURRENT_ATOM.size);
+    out_printf(", o=");
+    dump_file_size(CURRENT_ATOM.offset);
+    out_printf("\n");
+}
+
+static void dump_atom()
+{
+    dump_atom_header();
+
+    if (CURRENT_ATOM.rem_size > 0) {
+        out_key("data");
+        dump_bytes(CURRENT_ATOM.rem_size);
+    }
+}
+
+static uint32_t get_type_value(const char *type)
+{
+    return MKTAG(((const unsigned char*)type));
+}
+
+static void seek_file(uint64_t offset)
+{
+#if defined(_WIN32)
+    MOV_CHECK(_fseeki64(g_mov_file, offset, SEEK_SET) == 0);
+#else
+    MOV_CHECK(fseeko(g_mov_file, offset, SEEK_SET) == 0);
+#endif
+}
+
+// Reads bytes at <offset> without changing the read position
+static bool peek_bytes(uint64_t offset, unsigned char *bytes, uint32_t size)
+{
+    if (g_mov_map) {
+        if (offset < g_mov_map_offset ||
+            offset - g_mov_map_offset > g_mov_map_size ||
+            size > g_mov_map_size - (offset - g_mov_map_offset))
+        {
+            return false;
+        }
+        memcpy(bytes, &g_mov_map[offset - g_mov_map_offset], size);
+        return true;
+    }
+
+    seek_file(offset);
+    bool result = (fread(bytes, 1, size, g_mov_file) == size);
+    seek_file(g_file_offset);
+    return result;
+}
+
+// Finds the data of the first child atom with <type> in the atom data at <offset>
+static bool peek_child_atom(uint64_t offset, uint64_t size, const char *type, uint64_t *data_offset,
+                            uint64_t *data_size)
+{
+    while (size >= 8) {
+        unsigned char header[16];
+        if (!peek_bytes(offset, header, 8))
+            return false;
+
+        uint64_t atom_size = ((uint64_t)header[0] << 24) | ((uint64_t)header[1] << 16) |
+                             ((uint64_t)header[2] << 8) | (uint64_t)header[3];
+        uint64_t header_size = 8;
+        if (atom_size == 1) {
+            if (size < 16 || !peek_bytes(offset + 8, &header[8], 8))
+                return false;
+            atom_size = 0;
+            int i;
+            for (i = 8; i < 16; i++)
+                atom_size = (atom_size << 8) | header[i];
+            header_size = 16;
+        } else if (atom_size == 0) {
+            atom_size = size;
+        }
+        if (atom_size < header_size || atom_size > size)
+            return false;
+
+        if (memcmp(&header[4], type, 4) == 0) {
+            *data_offset = offset + header_size;
+            *data_size = atom_size - header_size;
+            return true;
+        }
+
+        offset += atom_size;
+        size -= atom_size;
     }
-}
 
-static void dump_uint32_fp(uint32_t value, uint8_t bits_left)
-{
-    printf("%f", value / (double)(1 << (32 - bits_left)));
+    return false;
 }
 
-static void dump_uint16_fp(uint16_t value, uint8_t bits_left)
+// Returns the component_sub_type in the 'mdia' 'hdlr' atom of the current 'trak' atom, or 0 if it is not found
+static uint32_t peek_trak_handler_type()
 {
-    printf("%f", value / (double)(1 << (16 - bits_left)));
-}
+    uint64_t mdia_offset, mdia_size;
+    uint64_t hdlr_offset, hdlr_size;
+    unsigned char hdlr_data[12];
+    if (!peek_child_atom(g_file_offset, CURRENT_ATOM.rem_size, "mdia", &mdia_offset, &mdia_size) ||
+        !peek_child_atom(mdia_offset, mdia_size, "hdlr", &hdlr_offset, &hdlr_size) ||
+        hdlr_size < sizeof(hdlr_data) ||
+        !peek_bytes(hdlr_offset, hdlr_data, sizeof(hdlr_data)))
+    {
+        return 0;
+    }
 
-static void dump_int16_fp(int16_t value, uint8_t bits_left)
-{
-    printf("%f", value / (double)(1 << (16 - bits_left)));
+    return get_type_value((const char*)&hdlr_data[8]);
 }
 
-static void dump_timestamp(uint64_t value)
+static bool parse_select_path(const char *path_str, vector<SelectSegment> *path)
 {
-    // 2082844800 = difference between Unix epoch (1970-01-01) and Apple epoch (1904-01-01)
-    time_t unix_secs = (time_t)(value - 2082844800);
-    struct tm *utc;
-    utc = gmtime(&unix_secs);
-    if (utc == 0) {
-        printf("%" PRIu64 " seconds since 1904-01-01", value);
-    } else {
-        printf("%04d-%02d-%02dT%02d:%02d:%02dZ (%" PRIu64 " sec since 1904-01-01)",
-               utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday,
-               utc->tm_hour, utc->tm_min, utc->tm_sec,
-               value);
+    path->clear();
+
+    const char *str = path_str;
+    while (true) {
+        SelectSegment segment;
+        memset(&segment, 0, sizeof(segment));
+
+        size_t len = strcspn(str, "/[");
+        if (len == 1 && str[0] == '*') {
+            segment.any_type = true;
+        } else if (len >= 1 && len <= 4) {
+            char type[4] = {' ', ' ', ' ', ' '};
+            memcpy(type, str, len);
+            segment.type = get_type_value(type);
+        } else {
+            return false;
+        }
+        str += len;
+
+        if (*str == '[') {
+            // the handler (component sub-type) qualifier is only supported for 'trak' atoms
+            size_t qual_len = strcspn(str + 1, "]");
+            if (segment.any_type || segment.type != MKTAG("trak") ||
+                qual_len < 1 || qual_len > 4 || str[1 + qual_len] != ']')
+            {
+                return false;
+            }
+            char qualifier[4] = {' ', ' ', ' ', ' '};
+            memcpy(qualifier, str + 1, qual_len);
+            segment.handler_type = get_type_value(qualifier);
+            segment.have_handler_type = true;
+            str += qual_len + 2;
+        }
+
+        path->push_back(segment);
+
+        if (*str == '\0')
+            break;
+        if (*str != '/')
+            return false;
+        str++;
     }
+
+    return true;
 }
 
-static void dump_matrix(uint32_t *matrix, int extra_indent_amount = 0)
+static SelectAction get_select_action()
 {
-    // matrix:
-    //    a  b  u
-    //    c  d  v
-    //    tx ty w
-    //
-    // order is: a, b, u, c, d, v, tx, ty, w
-    // all are fixed point 16.16, except u, v and w which are 2.30, hence w = 0x40000000 (1.0)
+    // the atom path includes the sample description data format as the parent of the atoms in a sample description
+    vector<uint32_t> atom_path;
+    size_t i;
+    for (i = 0; i < g_atoms.size(); i++) {
+        if (i > 0 && equals_type(g_atoms[i - 1].type, "stsd"))
+            atom_path.push_back(g_sample_entry_type);
+        atom_path.push_back(get_type_value(g_atoms[i].type));
+    }
 
-    int i, j;
-    for (i = 0; i < 3; i++) {
-        indent(extra_indent_amount);
-        for (j = 0; j < 3; j++) {
-            if (j != 0)
-                printf(" ");
-            if (j == 2)
-                dump_uint32_fp(matrix[i * 3 + j], 2);
-            else
-                dump_uint32_fp(matrix[i * 3 + j], 16);
+    if (equals_type(CURRENT_ATOM.type, "trak")) {
+        size_t j;
+        for (j = 0; j < g_select_paths.size(); j++) {
+            if (atom_path.size() <= g_select_paths[j].size() &&
+                g_select_paths[j][atom_path.size() - 1].have_handler_type)
+            {
+                g_trak_handler_type = peek_trak_handler_type();
+                break;
+            }
         }
-        printf("\n");
     }
-}
 
-static void dump_color(uint16_t red, uint16_t green, uint16_t blue)
-{
-    printf("RGB(0x%04x,0x%04x,0x%04x)", red, green, blue);
-}
+    SelectAction action = SELECT_SKIP;
+    size_t j;
+    for (j = 0; j < g_select_paths.size() && action != SELECT_DUMP; j++) {
+        const vector<SelectSegment> &path = g_select_paths[j];
+        if (atom_path.size() > path.size())
+            continue;
 
-static void dump_fragment_sample_flags(uint32_t flags)
-{
-    printf("res=0x%x, ",       (flags >> 28) &   0x0f);
-    printf("lead=0x%x, ",      (flags >> 26) &   0x03);
-    printf("deps_on=0x%x, ",   (flags >> 24) &   0x03);
-    printf("depd_on=0x%x, ",   (flags >> 22) &   0x03);
-    printf("red=0x%x, ",       (flags >> 20) &   0x03);
-    printf("pad=0x%x, ",       (flags >> 17) &   0x07);
-    printf("nsync=0x%x, ",     (flags >> 16) &   0x01);
-    printf("priority=0x%04x",   flags        & 0xffff);
+        for (i = 0; i < atom_path.size(); i++) {
+            if ((!path[i].any_type && path[i].type != atom_path[i]) ||
+                (path[i].have_handler_type && path[i].handler_type != g_trak_handler_type))
+            {
+                break;
+            }
+        }
+        if (i < atom_path.size())
+            continue;
+
+        if (atom_path.size() == path.size())
+            action = SELECT_DUMP;
+        else
+            action = SELECT_PARSE;
+    }
+
+    // atoms that set state used to parse or summarize other atoms are always parsed
+    if (action == SELECT_SKIP &&
+        (equals_type(CURRENT_ATOM.type, "ftyp") || equals_type(CURRENT_ATOM.type, "styp") ||
+            equals_type(CURRENT_ATOM.type, "mvhd") || equals_type(CURRENT_ATOM.type, "hdlr") ||
+            equals_type(CURRENT_ATOM.type, "keys") || equals_type(CURRENT_ATOM.type, "mdhd") ||
+            (!g_full_detail && HAVE_PREV_ATOM && equals_type(PREV_ATOM.type, "stbl") &&
+                (equals_type(CURRENT_ATOM.type, "stts") || equals_type(CURRENT_ATOM.type, "stsc") ||
+                    equals_type(CURRENT_ATOM.type, "stsz")))))
+    {
+        action = SELECT_PARSE;
+    }
+
+    return action;
 }
 
-static void dump_atom_header()
+// Returns false if the current atom is not selected and was skipped. Sets <selected> if the atom is selected and
+// output is enabled until end_select_atom() is called
+static bool begin_select_atom(bool *selected)
 {
-    indent_atom_header();
-    dump_type(CURRENT_ATOM.type);
-    printf(": s=");
-    dump_file_size(CURRENT_ATOM.size);
-    printf(", o=");
-    dump_file_size(CURRENT_ATOM.offset);
-    printf("\n");
+    *selected = false;
+    if (g_select_paths.empty() || g_selected_depth > 0)
+        return true;
+
+    SelectAction action = get_select_action();
+    if (action == SELECT_SKIP) {
+        skip_bytes(CURRENT_ATOM.rem_size);
+        return false;
+    }
+    if (action == SELECT_DUMP) {
+        g_selected_depth = g_atoms.size();
+        g_out_suppressed = false;
+        *selected = true;
+    }
+
+    return true;
 }
 
-static void dump_atom()
+static void end_select_atom(bool selected)
 {
-    dump_atom_header();
-
-    if (CURRENT_ATOM.rem_size > 0)
-        dump_bytes(CURRENT_ATOM.rem_size);
+    if (selected) {
+        g_selected_depth = 0;
+        g_out_suppressed = true;
+    }
 }
 
 static void dump_child_atom(const DumpFuncMap *dump_func_map, size_t dump_func_map_size)
 {
+    bool selected;
+    if (!begin_select_atom(&selected))
+        return;
+
     size_t i;
     for (i = 0; i < dump_func_map_size; i++) {
         if (dump_func_map[i].type[0] == '\0' || // any type
@@ -906,7 +2285,11 @@ static void dump_child_atom(const DumpFuncMap *dump_func_map, size_t dump_func_m
             dump_func_map[i].dump();
             if (CURRENT_ATOM.rem_size > 0) {
                 indent();
-                printf("remainder...: %" PRIu64 " unparsed bytes\n", CURRENT_ATOM.rem_size);
+                out_printf("remainder...: ");
+                out_key("unparsed_size");
+                out_uint(CURRENT_ATOM.rem_size);
+                out_printf(" unparsed bytes\n");
+                out_key("unparsed_data");
                 dump_bytes(CURRENT_ATOM.rem_size, 2);
             }
             break;
@@ -914,6 +2297,8 @@ static void dump_child_atom(const DumpFuncMap *dump_func_map, size_t dump_func_m
     }
     if (i >= dump_func_map_size)
         dump_atom();
+
+    end_select_atom(selected);
 }
 
 static void dump_container_atom(const DumpFuncMap *dump_func_map, size_t dump_func_map_size)
@@ -937,24 +2322,38 @@ static void dump_full_atom_header(uint8_t *version, uint32_t *flags, bool newlin
     dump_atom_header();
 
     MOV_CHECK(read_uint8(version));
-    indent();
-    printf("version: %u\n", (*version));
+    out_field_uint("version", *version);
 
     MOV_CHECK(read_uint24(flags));
-    indent();
-    printf("flags: 0x%06x", (*flags));
+    out_field_begin("flags");
+    out_hex(*flags, 6);
     if (newline_flags)
-        printf("\n");
+        out_field_end();
 }
 
 static void dump_unknown_version(uint8_t version)
 {
     indent();
-    printf("remainder...: unknown version %u, %" PRIu64 " unparsed bytes\n", version, CURRENT_ATOM.rem_size);
+    out_printf("remainder...: unknown version %u, ", version);
+    out_key("unparsed_size");
+    out_uint(CURRENT_ATOM.rem_size);
+    out_printf(" unparsed bytes\n");
+    out_key("unparsed_data");
     dump_bytes(CURRENT_ATOM.rem_size, 2);
 }
 
 
+// Writes the "entries (<num_entries>):" line that precedes a table
+static void dump_num_entries(uint32_t num_entries)
+{
+    indent();
+    out_printf("entries (");
+    out_key("num_entries");
+    dump_uint32(num_entries, false);
+    out_printf("):\n");
+}
+
+
 static void dump_ftyp_styp_atom()
 {
     dump_atom_header();
@@ -962,31 +2361,28 @@ static void dump_ftyp_styp_atom()
     uint32_t major_brand;
     MOV_CHECK(read_uint32(&major_brand));
     g_qt_brand = (major_brand == MKTAG("qt  "));
-    indent();
-    printf("major_brand: ");
-    dump_uint32_chars(major_brand);
-    printf("\n");
+    out_field_fourcc("major_brand", major_brand);
 
     uint32_t minor_version;
     MOV_CHECK(read_uint32(&minor_version));
-    indent();
-    printf("minor_version: ");
+    out_field_begin("minor_version");
     dump_uint32(minor_version, true);
-    printf("\n");
+    out_field_end();
 
     bool first = true;
     uint32_t compatible_brand;
-    indent();
-    printf("compatible_brands: ");
+    out_field_begin("compatible_brands");
+    out_array_begin();
     while (CURRENT_ATOM.rem_size >= 4) {
         MOV_CHECK(read_uint32(&compatible_brand));
         if (!first)
-            printf(", ");
+            out_printf(", ");
         else
             first = false;
         dump_uint32_chars(compatible_brand);
     }
-    printf("\n");
+    out_array_end();
+    out_field_end();
 }
 
 static void dump_mdat_atom()
@@ -995,7 +2391,10 @@ static void dump_mdat_atom()
 
     if (CURRENT_ATOM.rem_size > 0) {
         indent();
-        printf("...skipped %" PRIu64 " bytes\n", CURRENT_ATOM.rem_size);
+        out_printf("...skipped ");
+        out_key("skipped_size");
+        out_uint(CURRENT_ATOM.rem_size);
+        out_printf(" bytes\n");
         skip_bytes(CURRENT_ATOM.rem_size);
     }
 }
@@ -1006,7 +2405,10 @@ static void dump_free_atom()
 
     if (CURRENT_ATOM.rem_size > 0) {
         indent();
-        printf("...skipped %" PRIu64 " bytes\n", CURRENT_ATOM.rem_size);
+        out_printf("...skipped ");
+        out_key("skipped_size");
+        out_uint(CURRENT_ATOM.rem_size);
+        out_printf(" bytes\n");
         skip_bytes(CURRENT_ATOM.rem_size);
     }
 }
@@ -1017,7 +2419,10 @@ static void dump_skip_atom()
 
     if (CURRENT_ATOM.rem_size > 0) {
         indent();
-        printf("...skipped %" PRIu64 " bytes\n", CURRENT_ATOM.rem_size);
+        out_printf("...skipped ");
+        out_key("skipped_size");
+        out_uint(CURRENT_ATOM.rem_size);
+        out_printf(" bytes\n");
         skip_bytes(CURRENT_ATOM.rem_size);
     }
 }
@@ -1028,9 +2433,8 @@ static void dump_dref_child_atom()
     uint32_t flags;
     dump_full_atom_header(&version, &flags, false);
     if ((flags & 0x000001))
-        printf(" (self reference)\n");
-    else
-        printf("\n");
+        out_printf(" (self reference)");
+    out_field_end();
 
     if (version != 0x00) {
         dump_unknown_version(version);
@@ -1040,12 +2444,20 @@ static void dump_dref_child_atom()
 
     if (equals_type(CURRENT_ATOM.type, "url ")) {
         indent();
-        printf("data: (%" PRIu64 " bytes) url: ", CURRENT_ATOM.rem_size);
+        out_printf("data: (");
+        out_key("data_size");
+        out_uint(CURRENT_ATOM.rem_size);
+        out_printf(" bytes) url: ");
+        out_key("url");
         dump_string(CURRENT_ATOM.rem_size);
         return;
     } else {
         indent();
-        printf("data: (%" PRIu64 " bytes)\n", CURRENT_ATOM.rem_size);
+        out_printf("data: (");
+        out_key("data_size");
+        out_uint(CURRENT_ATOM.rem_size);
+        out_printf(" bytes)\n");
+        out_key("data");
         dump_bytes(CURRENT_ATOM.rem_size, 2);
         return;
     }
@@ -1066,9 +2478,10 @@ static void dump_dref_atom()
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
     indent();
-    printf("entries (");
+    out_printf("entries (");
+    out_key("num_entries");
     dump_uint32(num_entries, false);
-    printf("):\n");
+    out_printf("):\n");
 
     uint32_t i;
     for (i = 0; i < num_entries; i++) {
@@ -1077,12 +2490,429 @@ static void dump_dref_atom()
         if (!read_atom_start())
             break;
 
-        dump_dref_child_atom();
+        bool selected;
+        if (begin_select_atom(&selected)) {
+            dump_dref_child_atom();
+            end_select_atom(selected);
+        }
 
         pop_atom();
     }
 }
 
+// Sample table summaries
+
+static void read_stbl_uint32_table(vector<uint32_t> *values, uint32_t num_entries, uint32_t entry_size)
+{
+    MOV_CHECK((uint64_t)num_entries * entry_size <= CURRENT_ATOM.rem_size);
+    values->resize((size_t)num_entries * (entry_size / 4));
+    if (!values->empty())
+        read_uint32_array(&(*values)[0], values->size());
+}
+
+static void read_stbl_uint64_table(vector<uint64_t> *values, uint32_t num_entries)
+{
+    MOV_CHECK((uint64_t)num_entries * 8 <= CURRENT_ATOM.rem_size);
+    values->resize(num_entries);
+    if (!values->empty())
+        read_uint64_array(&(*values)[0], values->size());
+}
+
+static void reset_sample_table_state()
+{
+    g_stts_entries.clear();
+    g_stsc_entries.clear();
+    g_stsz_sample_size = 0;
+    g_stsz_sample_count = 0;
+    g_stsz_entries.clear();
+    g_have_stts = false;
+    g_have_stsc = false;
+    g_have_stsz = false;
+}
+
+static void dump_stts_summary(uint32_t num_entries)
+{
+    read_stbl_uint32_table(&g_stts_entries, num_entries, 8);
+    g_have_stts = true;
+
+    uint64_t sample_count = 0;
+    uint64_t duration = 0;
+    uint32_t min_delta = 0;
+    uint32_t max_delta = 0;
+    uint32_t i;
+    for (i = 0; i < num_entries; i++) {
+        uint32_t count = g_stts_entries[2 * i];
+        uint32_t delta = g_stts_entries[2 * i + 1];
+        sample_count += count;
+        duration += (uint64_t)count * delta;
+        if (i == 0 || delta < min_delta)
+            min_delta = delta;
+        if (i == 0 || delta > max_delta)
+            max_delta = delta;
+    }
+
+    out_field_begin("entries", "num_entries");
+    out_uint(num_entries);
+    out_field_end();
+    out_field_uint("samples", sample_count);
+    if (num_entries > 0) {
+        out_field_begin("sample_duration");
+        out_object_begin();
+        out_printf("min=");
+        out_key("min");
+        out_uint(min_delta);
+        out_printf(", max=");
+        out_key("max");
+        out_uint(max_delta);
+        out_object_end();
+        out_field_end();
+    }
+    out_field_duration("total_duration", duration, g_media_timescale);
+}
+
+static void dump_ctts_summary(uint32_t num_entries)
+{
+    vector<uint32_t> entries;
+    read_stbl_uint32_table(&entries, num_entries, 8);
+
+    uint64_t sample_count = 0;
+    int32_t min_offset = 0;
+    int32_t max_offset = 0;
+    uint32_t i;
+    for (i = 0; i < num_entries; i++) {
+        int32_t offset = (int32_t)entries[2 * i + 1];
+        sample_count += entries[2 * i];
+        if (i == 0 || offset < min_offset)
+            min_offset = offset;
+        if (i == 0 || offset > max_offset)
+            max_offset = offset;
+    }
+
+    out_field_begin("entries", "num_entries");
+    out_uint(num_entries);
+    out_field_end();
+    out_field_uint("samples", sample_count);
+    if (num_entries > 0) {
+        out_field_begin("sample_offset");
+        out_object_begin();
+        out_printf("min=");
+        out_key("min");
+        out_int(min_offset);
+        out_printf(", max=");
+        out_key("max");
+        out_int(max_offset);
+        out_object_end();
+        out_field_end();
+    }
+}
+
+static void dump_stsc_summary(uint32_t num_entries)
+{
+    read_stbl_uint32_table(&g_stsc_entries, num_entries, 12);
+    g_have_stsc = true;
+
+    uint32_t min_samples = 0;
+    uint32_t max_samples = 0;
+    uint32_t i;
+    for (i = 0; i < num_entries; i++) {
+        uint32_t samples_per_chunk = g_stsc_entries[3 * i + 1];
+        if (i == 0 || samples_per_chunk < min_samples)
+            min_samples = samples_per_chunk;
+        if (i == 0 || samples_per_chunk > max_samples)
+            max_samples = samples_per_chunk;
+    }
+
+    out_field_begin("entries", "num_entries");
+    out_uint(num_entries);
+    out_field_end();
+    if (num_entries > 0) {
+        out_field_begin("samples_per_chunk");
+        out_object_begin();
+        out_printf("min=");
+        out_key("min");
+        out_uint(min_samples);
+        out_printf(", max=");
+        out_key("max");
+        out_uint(max_samples);
+        out_object_end();
+        out_field_end();
+    }
+}
+
+static uint32_t get_sample_size(uint64_t index)
+{
+    if (g_stsz_sample_size > 0)
+        return g_stsz_sample_size;
+    return g_stsz_entries[(size_t)index];
+}
+
+// Prints the number of bits in each second of decode time, using the 'stts' sample durations and 'mdhd' timescale.
+// The profile is unavailable if the decode time exceeds MAX_BITRATE_PROFILE_SECS
+static void dump_bitrate_profile()
+{
+    if (!g_have_stts || g_media_timescale == 0 || g_stsz_sample_count == 0)
+        return;
+
+    vector<uint64_t> bits_per_sec;
+    uint64_t sample_index = 0;
+    uint64_t time = 0;
+    size_t i;
+    for (i = 0; i + 1 < g_stts_entries.size() && sample_index < g_stsz_sample_count; i += 2) {
+        uint32_t count = g_stts_entries[i];
+        uint32_t delta = g_stts_entries[i + 1];
+        uint32_t j;
+        for (j = 0; j < count && sample_index < g_stsz_sample_count; j++) {
+            uint64_t second = time / g_media_timescale;
+            if (second >= MAX_BITRATE_PROFILE_SECS) {
+                out_field_begin("bitrate_profile");
+                out_string("unavailable");
+                out_printf(" (decode time exceeds %d sec)", MAX_BITRATE_PROFILE_SECS);
+                out_field_end();
+                return;
+            }
+            if (second >= bits_per_sec.size())
+                bits_per_sec.resize((size_t)second + 1, 0);
+            bits_per_sec[second] += (uint64_t)get_sample_size(sample_index) * 8;
+            time += delta;
+            sample_index++;
+        }
+    }
+    if (bits_per_sec.empty())
+        return;
+
+    uint64_t min_bits = bits_per_sec[0];
+    uint64_t max_bits = bits_per_sec[0];
+    uint64_t total_bits = 0;
+    for (i = 0; i < bits_per_sec.size(); i++) {
+        if (bits_per_sec[i] < min_bits)
+            min_bits = bits_per_sec[i];
+        if (bits_per_sec[i] > max_bits)
+            max_bits = bits_per_sec[i];
+        total_bits += bits_per_sec[i];
+    }
+
+    out_field_begin("bitrate");
+    out_object_begin();
+    out_printf("min=");
+    out_key("min");
+    out_uint(min_bits);
+    out_printf(", max=");
+    out_key("max");
+    out_uint(max_bits);
+    out_printf(", mean=");
+    out_key("mean");
+    out_double(total_bits / (double)bits_per_sec.size(), 1);
+    out_printf(" bits/sec");
+    out_object_end();
+    out_field_end();
+
+    indent();
+    out_printf("bitrate_profile (%" PRIu64 " sec):\n", (uint64_t)bits_per_sec.size());
+    out_table_begin("bitrate_profile", bits_per_sec.size(), "       bits/sec");
+    for (i = 0; i < bits_per_sec.size(); i++) {
+        out_row_begin(bits_per_sec.size(), i);
+        out_key("bits_per_sec");
+        out_uint(bits_per_sec[i], 13);
+        out_row_end();
+    }
+    out_table_end();
+}
+
+static void dump_stsz_summary(uint32_t sample_size, uint32_t num_entries)
+{
+    g_stsz_sample_size = sample_size;
+    g_stsz_sample_count = num_entries;
+    if (sample_size == 0)
+        read_stbl_uint32_table(&g_stsz_entries, num_entries, 4);
+    else
+        g_stsz_entries.clear();
+    g_have_stsz = true;
+
+    out_field_begin("entries", "num_entries");
+    out_uint(num_entries);
+    out_field_end();
+    if (num_entries == 0)
+        return;
+
+    uint32_t min_size = get_sample_size(0);
+    uint32_t max_size = min_size;
+    uint64_t total_size = 0;
+    uint32_t i;
+    for (i = 0; i < num_entries; i++) {
+        uint32_t size = get_sample_size(i);
+        if (size < min_size)
+            min_size = size;
+        if (size > max_size)
+            max_size = size;
+        total_size += size;
+    }
+
+    out_field_begin("size");
+    out_object_begin();
+    out_printf("min=");
+    out_key("min");
+    out_uint(min_size);
+    out_printf(", max=");
+    out_key("max");
+    out_uint(max_size);
+    out_printf(", mean=");
+    out_key("mean");
+    out_double(total_size / (double)num_entries, 1);
+    out_object_end();
+    out_field_end();
+    out_field_uint("total_size", total_size);
+
+    dump_bitrate_profile();
+}
+
+// Prints the offset range and monotonicity and, using the 'stsc' and 'stsz' tables, the chunk layout and the gaps
+// between the end of a chunk and the start of the next chunk
+static void dump_chunk_offset_summary(const vector<uint64_t> &offsets)
+{
+    out_field_begin("entries", "num_entries");
+    out_uint(offsets.size());
+    out_field_end();
+    if (offsets.empty())
+        return;
+
+    uint64_t num_decreasing = 0;
+    uint64_t min_offset = offsets[0];
+    uint64_t max_offset = offsets[0];
+    size_t i;
+    for (i = 1; i < offsets.size(); i++) {
+        if (offsets[i] < offsets[i - 1])
+            num_decreasing++;
+        if (offsets[i] < min_offset)
+            min_offset = offsets[i];
+        if (offsets[i] > max_offset)
+            max_offset = offsets[i];
+    }
+
+    out_field_begin("offset");
+    out_object_begin();
+    out_printf("first=");
+    out_key("first");
+    out_uint(offsets[0]);
+    out_printf(", last=");
+    out_key("last");
+    out_uint(offsets.back());
+    out_printf(", min=");
+    out_key("min");
+    out_uint(min_offset);
+    out_printf(", max=");
+    out_key("max");
+    out_uint(max_offset);
+    out_object_end();
+    out_field_end();
+    out_field_begin("monotonic");
+    out_bool(num_decreasing == 0);
+    if (num_decreasing > 0) {
+        out_printf(" (");
+        out_key("decreasing_offsets");
+        out_uint(num_decreasing);
+        out_printf(" decreasing offsets)");
+    }
+    out_field_end();
+
+    if (!g_have_stsc || !g_have_stsz)
+        return;
+
+    // chunk sizes from the samples-per-chunk runs and sample sizes
+    vector<uint64_t> chunk_sizes(offsets.size(), 0);
+    uint64_t sample_index = 0;
+    uint32_t min_samples = 0;
+    uint32_t max_samples = 0;
+    size_t entry_index = 0;
+    for (i = 0; i < offsets.size(); i++) {
+        while (entry_index + 1 < g_stsc_entries.size() / 3 && g_stsc_entries[3 * (entry_index + 1)] <= i + 1)
+            entry_index++;
+        uint32_t samples_per_chunk = (g_stsc_entries.empty() ? 0 : g_stsc_entries[3 * entry_index + 1]);
+        if (i == 0 || samples_per_chunk < min_samples)
+            min_samples = samples_per_chunk;
+        if (i == 0 || samples_per_chunk > max_samples)
+            max_samples = samples_per_chunk;
+
+        uint32_t j;
+        for (j = 0; j < samples_per_chunk && sample_index < g_stsz_sample_count; j++)
+            chunk_sizes[i] += get_sample_size(sample_index++);
+    }
+
+    out_field_begin("chunk_layout");
+    out_object_begin();
+    out_key("chunks");
+    out_uint(offsets.size());
+    out_printf(" chunks, samples_per_chunk min=");
+    out_key("min_samples_per_chunk");
+    out_uint(min_samples);
+    out_printf(", max=");
+    out_key("max_samples_per_chunk");
+    out_uint(max_samples);
+    out_printf(", ");
+    out_key("samples");
+    out_uint(sample_index);
+    out_printf(" of ");
+    out_key("total_samples");
+    out_uint(g_stsz_sample_count);
+    out_printf(" samples");
+    out_object_end();
+    out_field_end();
+
+    uint64_t num_gaps = 0;
+    uint64_t num_overlaps = 0;
+    uint64_t min_gap = 0;
+    uint64_t max_gap = 0;
+    uint64_t total_gap = 0;
+    for (i = 0; i + 1 < offsets.size(); i++) {
+        uint64_t chunk_end = offsets[i] + chunk_sizes[i];
+        if (offsets[i + 1] < chunk_end) {
+            if (offsets[i + 1] > offsets[i])
+                num_overlaps++;
+        } else if (offsets[i + 1] > chunk_end) {
+            uint64_t gap = offsets[i + 1] - chunk_end;
+            if (num_gaps == 0 || gap < min_gap)
+                min_gap = gap;
+            if (num_gaps == 0 || gap > max_gap)
+                max_gap = gap;
+            total_gap += gap;
+            num_gaps++;
+        }
+    }
+
+    out_field_begin("gaps");
+    out_uint(num_gaps);
+    if (num_gaps > 0) {
+        out_printf(" (min=");
+        out_key("min_gap");
+        out_uint(min_gap);
+        out_printf(", max=");
+        out_key("max_gap");
+        out_uint(max_gap);
+        out_printf(", total=");
+        out_key("total_gap");
+        out_uint(total_gap);
+        out_printf(" bytes)");
+    }
+    out_field_end();
+    out_field_uint("overlaps", num_overlaps);
+}
+
+static void dump_stco_summary(uint32_t num_entries)
+{
+    vector<uint32_t> entries;
+    read_stbl_uint32_table(&entries, num_entries, 4);
+
+    vector<uint64_t> offsets(entries.begin(), entries.end());
+    dump_chunk_offset_summary(offsets);
+}
+
+static void dump_co64_summary(uint32_t num_entries)
+{
+    vector<uint64_t> offsets;
+    read_stbl_uint64_table(&offsets, num_entries);
+
+    dump_chunk_offset_summary(offsets);
+}
+
 static void dump_stts_atom()
 {
     uint8_t version;
@@ -1097,37 +2927,34 @@ static void dump_stts_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_stts_summary(num_entries);
+        return;
+    }
+
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("       count   duration\n");
+        out_table_begin("entries", num_entries, "       count   duration");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 8);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint32_t sample_count;
-            MOV_CHECK(read_uint32(&sample_count));
-            uint32_t sample_duration;
-            MOV_CHECK(read_uint32(&sample_duration));
+            uint32_t sample_count = entries[2 * i];
+            uint32_t sample_duration = entries[2 * i + 1];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
+            out_key("count");
             dump_uint32(sample_count, true);
-            printf(" ");
+            out_printf(" ");
+            out_key("duration");
             dump_uint32(sample_duration, true);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1145,37 +2972,34 @@ static void dump_ctts_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_ctts_summary(num_entries);
+        return;
+    }
+
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("       count     offset\n");
+        out_table_begin("entries", num_entries, "       count     offset");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 8);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint32_t sample_count;
-            MOV_CHECK(read_uint32(&sample_count));
-            int32_t sample_offset;
-            MOV_CHECK(read_int32(&sample_offset));
+            uint32_t sample_count = entries[2 * i];
+            int32_t sample_offset = (int32_t)entries[2 * i + 1];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
+            out_key("count");
             dump_uint32(sample_count, true);
-            printf(" ");
+            out_printf(" ");
+            out_key("offset");
             dump_int32(sample_offset);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1193,28 +3017,23 @@ static void dump_cslg_atom()
 
     int32_t dts_shift;
     MOV_CHECK(read_int32(&dts_shift));
-    indent();
-    printf("dts_shift: %d\n", dts_shift);
+    out_field_int("dts_shift", dts_shift);
 
     int32_t min_cts;
     MOV_CHECK(read_int32(&min_cts));
-    indent();
-    printf("min_cts: %d\n", min_cts);
+    out_field_int("min_cts", min_cts);
 
     int32_t max_cts;
     MOV_CHECK(read_int32(&max_cts));
-    indent();
-    printf("max_cts: %d\n", max_cts);
+    out_field_int("max_cts", max_cts);
 
     int32_t pts_start;
     MOV_CHECK(read_int32(&pts_start));
-    indent();
-    printf("pts_start: %d\n", pts_start);
+    out_field_int("pts_start", pts_start);
 
     int32_t pts_end;
     MOV_CHECK(read_int32(&pts_end));
-    indent();
-    printf("pts_end: %d\n", pts_end);
+    out_field_int("pts_end", pts_end);
 }
 
 static void dump_stss_stps_atom()
@@ -1231,33 +3050,25 @@ static void dump_stss_stps_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("      sample\n");
+        out_table_begin("entries", num_entries, "      sample");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 4);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint32_t sample;
-            MOV_CHECK(read_uint32(&sample));
+            uint32_t sample = entries[i];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
+            out_key("sample");
             dump_uint32(sample, true);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1274,20 +3085,10 @@ static void dump_sdtp_atom()
 
 
     uint32_t num_entries = (uint32_t)CURRENT_ATOM.rem_size;
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("    is_leading  depends  dependent  redundancy\n");
+        out_table_begin("entries", num_entries, "    is_leading  depends  dependent  redundancy");
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
@@ -1301,13 +3102,23 @@ static void dump_sdtp_atom()
             uint8_t dependent_on = (sample & 0x0c) >> 2;
             uint8_t has_redundancy = (sample & 0x03);
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
-
-            printf("           %d        %d          %d           %d\n",
-                   is_leading, depends_on, dependent_on, has_redundancy);
+            out_row_begin(num_entries, i);
+
+            out_printf("           ");
+            out_key("is_leading");
+            out_uint(is_leading);
+            out_printf("        ");
+            out_key("depends");
+            out_uint(depends_on);
+            out_printf("          ");
+            out_key("dependent");
+            out_uint(dependent_on);
+            out_printf("           ");
+            out_key("redundancy");
+            out_uint(has_redundancy);
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1325,42 +3136,39 @@ static void dump_stsc_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_stsc_summary(num_entries);
+        return;
+    }
 
-    if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("  first chunk  samples-per-chunk         descr. id\n");
+    dump_num_entries(num_entries);
+
+    if (num_entries > 0) {
+        out_table_begin("entries", num_entries, "  first chunk  samples-per-chunk         descr. id");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 12);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint32_t first_chunk;
-            MOV_CHECK(read_uint32(&first_chunk));
-            uint32_t samples_per_chunk;
-            MOV_CHECK(read_uint32(&samples_per_chunk));
-            uint32_t sample_description_id;
-            MOV_CHECK(read_uint32(&sample_description_id));
+            uint32_t first_chunk = entries[3 * i];
+            uint32_t samples_per_chunk = entries[3 * i + 1];
+            uint32_t sample_description_id = entries[3 * i + 2];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
-            printf(" ");
+            out_printf(" ");
+            out_key("first_chunk");
             dump_uint32(first_chunk, true);
-            printf("         ");
+            out_printf("         ");
+            out_key("samples_per_chunk");
             dump_uint32(samples_per_chunk, true);
-            printf("        ");
+            out_printf("        ");
+            out_key("sample_description_id");
             dump_uint32(sample_description_id, false);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1378,48 +3186,44 @@ static void dump_stsz_atom()
 
     uint32_t sample_size;
     MOV_CHECK(read_uint32(&sample_size));
-    indent();
-    printf("sample_size: %d\n", sample_size);
+    out_field_int("sample_size", (int32_t)sample_size);
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_stsz_summary(sample_size, num_entries);
+        return;
+    }
+
+    dump_num_entries(num_entries);
 
     if (CURRENT_ATOM.rem_size == 0) {
         if (num_entries > 0) {
             indent(4);
-            printf("...none\n");
+            out_printf("...none\n");
         }
         MOV_CHECK(sample_size > 0 || num_entries == 0);
         return;
     }
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("         size\n");
+        out_table_begin("entries", num_entries, "         size");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 4);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            int32_t size;
-            MOV_CHECK(read_int32(&size));
+            uint32_t size = entries[i];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
-            printf(" ");
+            out_printf(" ");
+            out_key("size");
             dump_uint32(size, true);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1437,33 +3241,30 @@ static void dump_stco_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_stco_summary(num_entries);
+        return;
+    }
+
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("      offset (hex offset)\n");
+        out_table_begin("entries", num_entries, "      offset (hex offset)");
+
+        vector<uint32_t> entries;
+        read_stbl_uint32_table(&entries, num_entries, 4);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint32_t offset;
-            MOV_CHECK(read_uint32(&offset));
+            uint32_t offset = entries[i];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
+            out_key("offset");
             dump_uint32_size(offset);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1481,33 +3282,30 @@ static void dump_co64_atom()
 
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
-    indent();
-    printf("entries (");
-    dump_uint32(num_entries, false);
-    printf("):\n");
+    if (!g_full_detail) {
+        dump_co64_summary(num_entries);
+        return;
+    }
+
+    dump_num_entries(num_entries);
 
     if (num_entries > 0) {
-        indent(4);
-        if (num_entries < 0xffff)
-            printf("   i");
-        else if (num_entries < 0xffffff)
-            printf("     i");
-        else
-            printf("       i");
-        printf("                offset         (hex offset)\n");
+        out_table_begin("entries", num_entries, "                offset         (hex offset)");
+
+        vector<uint64_t> entries;
+        read_stbl_uint64_table(&entries, num_entries);
 
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
-            uint64_t offset;
-            MOV_CHECK(read_uint64(&offset));
+            uint64_t offset = entries[i];
 
-            indent(4);
-            dump_uint32_index(num_entries, i);
-            printf("  ");
+            out_row_begin(num_entries, i);
 
+            out_key("offset");
             dump_uint64_size(offset);
-            printf("\n");
+            out_row_end();
         }
+        out_table_end();
     }
 }
 
@@ -1525,17 +3323,15 @@ static void dump_hdlr_atom()
 
     uint32_t component_type;
     MOV_CHECK(read_uint32(&component_type));
-    indent();
-    printf("component_type: ");
+    out_field_begin("component_type");
     dump_uint32_chars(component_type);
-    printf("\n");
+    out_field_end();
 
     uint32_t component_sub_type;
     MOV_CHECK(read_uint32(&component_sub_type));
-    indent();
-    printf("component_sub_type: ");
+    out_field_begin("component_sub_type");
     dump_uint32_tag(component_sub_type);
-    printf("\n");
+    out_field_end();
 
     if (HAVE_PREV_ATOM && strncmp(PREV_ATOM.type, "mdia", 4) == 0) {
         g_component_type = component_type;
@@ -1544,18 +3340,15 @@ static void dump_hdlr_atom()
 
     uint32_t component_manufacturer;
     MOV_CHECK(read_uint32(&component_manufacturer));
-    indent();
-    printf("component_manufacturer: %u\n", component_manufacturer);
+    out_field_uint("component_manufacturer", component_manufacturer);
 
     uint32_t component_flags;
     MOV_CHECK(read_uint32(&component_flags));
-    indent();
-    printf("component_flags: 0x%08x\n", component_flags);
+    out_field_hex("component_flags", component_flags, 8);
 
     uint32_t component_flags_mask;
     MOV_CHECK(read_uint32(&component_flags_mask));
-    indent();
-    printf("component_flags_mask: 0x%08x\n", component_flags_mask);
+    out_field_hex("component_flags_mask", component_flags_mask, 8);
 
     if (CURRENT_ATOM.rem_size > 0) {
         uint64_t component_name_len;
@@ -1566,13 +3359,8 @@ static void dump_hdlr_atom()
         } else {
             component_name_len = CURRENT_ATOM.rem_size;
         }
-        indent();
-        printf("component_name: ");
-        if (component_name_len == 0) {
-            printf("\n");
-        } else {
-            dump_string(component_name_len, 2);
-        }
+        out_field_begin("component_name");
+        dump_string(component_name_len, 2);
     }
 }
 
@@ -1586,7 +3374,14 @@ static void dump_international_string_atom()
     MOV_CHECK(read_uint16(&language_code));
 
     indent();
-    printf("value: (len=%d,lang=0x%04x) ", len, language_code);
+    out_printf("value: (len=");
+    out_key("len");
+    out_uint(len);
+    out_printf(",lang=");
+    out_key("language");
+    out_hex(language_code, 4);
+    out_printf(") ");
+    out_key("value");
     dump_string(len, 2);
 }
 
@@ -1596,26 +3391,22 @@ static void dump_colr_atom()
 
     uint32_t color_param_type;
     MOV_CHECK(read_uint32(&color_param_type));
-    indent();
-    printf("color_param_type: ");
+    out_field_begin("color_param_type");
     dump_uint32_tag(color_param_type);
-    printf("\n");
+    out_field_end();
 
     if (color_param_type == MKTAG("nclc")) {
         uint16_t primaries;
         MOV_CHECK(read_uint16(&primaries));
-        indent();
-        printf("primaries: %u\n", primaries);
+        out_field_uint("primaries", primaries);
 
         uint16_t transfer_func;
         MOV_CHECK(read_uint16(&transfer_func));
-        indent();
-        printf("transfer_func: %u\n", transfer_func);
+        out_field_uint("transfer_func", transfer_func);
 
         uint16_t matrix;
         MOV_CHECK(read_uint16(&matrix));
-        indent();
-        printf("matrix: %u\n", matrix);
+        out_field_uint("matrix", matrix);
     }
 }
 
@@ -1625,19 +3416,17 @@ static void dump_fiel_atom()
 
     uint8_t fields;
     MOV_CHECK(read_uint8(&fields));
-    indent();
-    printf("fields: %u", fields);
+    out_field_begin("fields");
+    out_uint(fields);
     if (fields == 1)
-        printf(" (progressive)\n");
+        out_printf(" (progressive)");
     else if (fields == 2)
-        printf(" (interlaced)\n");
-    else
-        printf("\n");
+        out_printf(" (interlaced)");
+    out_field_end();
 
     uint8_t detail;
     MOV_CHECK(read_uint8(&detail));
-    indent();
-    printf("detail: %u\n", detail);
+    out_field_uint("detail", detail);
 }
 
 static void dump_pasp_atom()
@@ -1646,13 +3435,11 @@ static void dump_pasp_atom()
 
     int32_t h_spacing;
     MOV_CHECK(read_int32(&h_spacing));
-    indent();
-    printf("h_spacing: %d\n", h_spacing);
+    out_field_int("h_spacing", h_spacing);
 
     int32_t v_spacing;
     MOV_CHECK(read_int32(&v_spacing));
-    indent();
-    printf("v_spacing: %d\n", v_spacing);
+    out_field_int("v_spacing", v_spacing);
 }
 
 static void dump_clap_atom()
@@ -1662,26 +3449,54 @@ static void dump_clap_atom()
     int32_t clean_ap_width_num, clean_ap_width_den;
     MOV_CHECK(read_int32(&clean_ap_width_num));
     MOV_CHECK(read_int32(&clean_ap_width_den));
-    indent();
-    printf("clean_aperture_width: %d/%d\n", clean_ap_width_num, clean_ap_width_den);
+    out_field_begin("clean_aperture_width");
+    out_object_begin();
+    out_key("num");
+    out_int(clean_ap_width_num);
+    out_printf("/");
+    out_key("den");
+    out_int(clean_ap_width_den);
+    out_object_end();
+    out_field_end();
 
     int32_t clean_ap_height_num, clean_ap_height_den;
     MOV_CHECK(read_int32(&clean_ap_height_num));
     MOV_CHECK(read_int32(&clean_ap_height_den));
-    indent();
-    printf("clean_aperture_height: %d/%d\n", clean_ap_height_num, clean_ap_height_den);
+    out_field_begin("clean_aperture_height");
+    out_object_begin();
+    out_key("num");
+    out_int(clean_ap_height_num);
+    out_printf("/");
+    out_key("den");
+    out_int(clean_ap_height_den);
+    out_object_end();
+    out_field_end();
 
     int32_t horiz_offset_num, horiz_offset_den;
     MOV_CHECK(read_int32(&horiz_offset_num));
     MOV_CHECK(read_int32(&horiz_offset_den));
-    indent();
-    printf("horiz_offset: %d/%d\n", horiz_offset_num, horiz_offset_den);
+    out_field_begin("horiz_offset");
+    out_object_begin();
+    out_key("num");
+    out_int(horiz_offset_num);
+    out_printf("/");
+    out_key("den");
+    out_int(horiz_offset_den);
+    out_object_end();
+    out_field_end();
 
     int32_t vert_offset_num, vert_offset_den;
     MOV_CHECK(read_int32(&vert_offset_num));
     MOV_CHECK(read_int32(&vert_offset_den));
-    indent();
-    printf("vert_offset: %d/%d\n", vert_offset_num, vert_offset_den);
+    out_field_begin("vert_offset");
+    out_object_begin();
+    out_key("num");
+    out_int(vert_offset_num);
+    out_printf("/");
+    out_key("den");
+    out_int(vert_offset_den);
+    out_object_end();
+    out_field_end();
 }
 
 static void dump_avcc_atom()
@@ -1690,49 +3505,65 @@ static void dump_avcc_atom()
 
     uint8_t configuration_version;
     MOV_CHECK(read_uint8(&configuration_version));
-    indent();
-    printf("configuration_version: %u\n", configuration_version);
+    out_field_uint("configuration_version", configuration_version);
 
     uint8_t profile_idc;
     MOV_CHECK(read_uint8(&profile_idc));
     uint8_t constraint_flags_byte;
     MOV_CHECK(read_uint8(&constraint_flags_byte));
-    indent();
-    printf("profile_idc: %u ('%s')\n", profile_idc, get_profile_string(profile_idc, constraint_flags_byte));
-    indent();
-    printf("constraint_flags_byte: ");
+    out_field_begin("profile_idc");
+    out_uint(profile_idc);
+    out_printf(" ('");
+    out_key("profile");
+    out_string(get_profile_string(profile_idc, constraint_flags_byte));
+    out_printf("')");
+    out_field_end();
+    out_field_begin("constraint_flags_byte");
     dump_uint8(constraint_flags_byte, true);
-    printf("\n");
+    out_field_end();
 
     uint8_t level_idc;
     MOV_CHECK(read_uint8(&level_idc));
-    indent();
+    out_field_begin("level_idc");
+    out_uint(level_idc);
     if (level_idc == 11 && (constraint_flags_byte & 0x10))
-        printf("level_idc: %u (1b)\n", level_idc);
+        out_printf(" (1b)");
     else
-        printf("level_idc: %u (%.1f)\n", level_idc, level_idc / 10.0);
+        out_printf(" (%.1f)", level_idc / 10.0);
+    out_field_end();
 
     uint8_t length_size_minus1_byte, length_size;
     MOV_CHECK(read_uint8(&length_size_minus1_byte));
     length_size = (length_size_minus1_byte & 0x03) + 1;
-    indent();
-    printf("length_size_minus1_byte: 0x%02x (length_size=%u)\n", length_size_minus1_byte, length_size);
+    out_field_begin("length_size_minus1_byte");
+    out_hex(length_size_minus1_byte, 2);
+    out_printf(" (length_size=");
+    out_key("length_size");
+    out_uint(length_size);
+    out_printf(")");
+    out_field_end();
 
     uint8_t num_sps_byte, num_sps;
     MOV_CHECK(read_uint8(&num_sps_byte));
     num_sps = num_sps_byte & 0x1f;
-    indent();
-    printf("num_sps_byte: 0x%02x (num_sps=%u)\n", num_sps_byte, num_sps);
+    out_field_begin("num_sps_byte");
+    out_hex(num_sps_byte, 2);
+    out_printf(" (num_sps=");
+    out_key("num_sps");
+    out_uint(num_sps);
+    out_printf(")");
+    out_field_end();
 
     unsigned char *buffer = 0;
     size_t buffer_size = 0;
     uint8_t i;
+    out_array_begin("sps", 4);
     for (i = 0; i < num_sps; i++) {
         uint16_t sps_size;
         MOV_CHECK(read_uint16(&sps_size));
 
         indent(4);
-        printf("sps %u:\n", i);
+        out_printf("sps %u:\n", i);
 
         if (g_avcc_filename) {
             write_avcc_ps(&buffer, &buffer_size, length_size, sps_size);
@@ -1741,18 +3572,19 @@ static void dump_avcc_atom()
             dump_bytes(sps_size, 6);
         }
     }
+    out_array_end();
 
     uint8_t num_pps;
     MOV_CHECK(read_uint8(&num_pps));
-    indent();
-    printf("num_pps: %u\n", num_pps);
+    out_field_uint("num_pps", num_pps);
 
+    out_array_begin("pps", 4);
     for (i = 0; i < num_pps; i++) {
         uint16_t pps_size;
         MOV_CHECK(read_uint16(&pps_size));
 
         indent(4);
-        printf("pps %u:\n", i);
+        out_printf("pps %u:\n", i);
         if (g_avcc_filename) {
             write_avcc_ps(&buffer, &buffer_size, length_size, pps_size);
             dump_bytes(buffer, pps_size, 6);
@@ -1760,40 +3592,56 @@ static void dump_avcc_atom()
             dump_bytes(pps_size, 6);
         }
     }
+    out_array_end();
 
     if (CURRENT_ATOM.rem_size >= 4) {
         uint8_t chroma_format_byte, chroma_format;
         MOV_CHECK(read_uint8(&chroma_format_byte));
         chroma_format = chroma_format_byte & 0x03;
-        indent();
-        printf("chroma_format_byte: 0x%02x (chroma_format=%u '%s')\n", chroma_format_byte, chroma_format,
-               get_chroma_format_string(chroma_format));
+        out_field_begin("chroma_format_byte");
+        out_hex(chroma_format_byte, 2);
+        out_printf(" (chroma_format=");
+        out_key("chroma_format");
+        out_uint(chroma_format);
+        out_printf(" '");
+        out_key("chroma_format_name");
+        out_string(get_chroma_format_string(chroma_format));
+        out_printf("')");
+        out_field_end();
 
         uint8_t bit_depth_luma_minus8_byte, bit_depth_luma;
         MOV_CHECK(read_uint8(&bit_depth_luma_minus8_byte));
         bit_depth_luma = (bit_depth_luma_minus8_byte & 0x07) + 8;
-        indent();
-        printf("bit_depth_luma_minus8_byte: 0x%02x (bit_depth_luma=%u)\n",
-               bit_depth_luma_minus8_byte, bit_depth_luma);
+        out_field_begin("bit_depth_luma_minus8_byte");
+        out_hex(bit_depth_luma_minus8_byte, 2);
+        out_printf(" (bit_depth_luma=");
+        out_key("bit_depth_luma");
+        out_uint(bit_depth_luma);
+        out_printf(")");
+        out_field_end();
 
         uint8_t bit_depth_chroma_minus8_byte, bit_depth_chroma;
         MOV_CHECK(read_uint8(&bit_depth_chroma_minus8_byte));
         bit_depth_chroma = (bit_depth_chroma_minus8_byte & 0x07) + 8;
-        indent();
-        printf("bit_depth_chroma_minus8_byte: 0x%02x (bit_depth_chroma=%u)\n",
-               bit_depth_chroma_minus8_byte, bit_depth_chroma);
+        out_field_begin("bit_depth_chroma_minus8_byte");
+        out_hex(bit_depth_chroma_minus8_byte, 2);
+        out_printf(" (bit_depth_chroma=");
+        out_key("bit_depth_chroma");
+        out_uint(bit_depth_chroma);
+        out_printf(")");
+        out_field_end();
 
         uint8_t num_sps_ext;
         MOV_CHECK(read_uint8(&num_sps_ext));
-        indent();
-        printf("num_sps_ext: %u\n", num_sps_ext);
+        out_field_uint("num_sps_ext", num_sps_ext);
 
+        out_array_begin("sps_ext", 4);
         for (i = 0; i < num_sps_ext; i++) {
             uint16_t sps_ext_size;
             MOV_CHECK(read_uint16(&sps_ext_size));
 
             indent(4);
-            printf("sps ext %u:\n", i);
+            out_printf("sps ext %u:\n", i);
             if (g_avcc_filename) {
                 write_avcc_ps(&buffer, &buffer_size, length_size, sps_ext_size);
                 dump_bytes(buffer, sps_ext_size, 6);
@@ -1801,6 +3649,7 @@ static void dump_avcc_atom()
                 dump_bytes(sps_ext_size, 6);
             }
         }
+        out_array_end();
     }
 
     free(buffer);
@@ -1812,18 +3661,15 @@ static void dump_btrt_atom()
 
     uint32_t buffer_size_db;
     MOV_CHECK(read_uint32(&buffer_size_db));
-    indent();
-    printf("buffer_size_db: 0x%04x\n", buffer_size_db);
+    out_field_hex("buffer_size_db", buffer_size_db, 4);
 
     uint32_t max_bitrate;
     MOV_CHECK(read_uint32(&max_bitrate));
-    indent();
-    printf("max_bitrate: %u\n", max_bitrate);
+    out_field_uint("max_bitrate", max_bitrate);
 
     uint32_t avg_bitrate;
     MOV_CHECK(read_uint32(&avg_bitrate));
-    indent();
-    printf("avg_bitrate: %u\n", avg_bitrate);
+    out_field_uint("avg_bitrate", avg_bitrate);
 }
 
 static uint32_t dump_stbl_vide(uint32_t size)
@@ -1843,81 +3689,67 @@ static uint32_t dump_stbl_vide(uint32_t size)
 
     uint16_t version;
     MOV_CHECK(read_uint16(&version));
-    indent(2);
-    printf("version: %u\n", version);
+    out_field_uint("version", version);
 
     uint16_t revision;
     MOV_CHECK(read_uint16(&revision));
-    indent(2);
-    printf("revision: 0x%04x\n", revision);
+    out_field_hex("revision", revision, 4);
 
     uint32_t vendor;
     MOV_CHECK(read_uint32(&vendor));
-    indent(2);
-    printf("vendor: ");
+    out_field_begin("vendor");
     dump_uint32_chars(vendor);
-    printf("\n");
+    out_field_end();
 
     uint32_t temporal_quality;
     MOV_CHECK(read_uint32(&temporal_quality));
-    indent(2);
-    printf("temporal_quality: 0x%08x\n", temporal_quality);
+    out_field_hex("temporal_quality", temporal_quality, 8);
 
     uint32_t spatial_quality;
     MOV_CHECK(read_uint32(&spatial_quality));
-    indent(2);
-    printf("spatial_quality: 0x%08x\n", spatial_quality);
+    out_field_hex("spatial_quality", spatial_quality, 8);
 
     uint16_t width;
     MOV_CHECK(read_uint16(&width));
-    indent(2);
-    printf("width: %u\n", width);
+    out_field_uint("width", width);
 
     uint16_t height;
     MOV_CHECK(read_uint16(&height));
-    indent(2);
-    printf("height: %u\n", height);
+    out_field_uint("height", height);
 
     uint32_t horizontal_resolution;
     MOV_CHECK(read_uint32(&horizontal_resolution));
-    indent(2);
-    printf("horizontal_resolution: ");
+    out_field_begin("horizontal_resolution");
     dump_uint32_fp(horizontal_resolution, 16);
-    printf("\n");
+    out_field_end();
 
     uint32_t vertical_resolution;
     MOV_CHECK(read_uint32(&vertical_resolution));
-    indent(2);
-    printf("vertical_resolution: ");
+    out_field_begin("vertical_resolution");
     dump_uint32_fp(vertical_resolution, 16);
-    printf("\n");
+    out_field_end();
 
     uint32_t data_size;
     MOV_CHECK(read_uint32(&data_size));
-    indent(2);
-    printf("data_size: %u\n", data_size);
+    out_field_uint("data_size", data_size);
 
     uint16_t frame_count;
     MOV_CHECK(read_uint16(&frame_count));
-    indent(2);
-    printf("frame_count: %u\n", frame_count);
+    out_field_uint("frame_count", frame_count);
 
     uint8_t compressor_name_len;
     MOV_CHECK(read_uint8(&compressor_name_len));
     MOV_CHECK(compressor_name_len - 1 <= 32);
-    indent(2);
-    printf("compressor_name: ");
+    out_field_begin("compressor_name");
     dump_string(31, 4);
 
     uint16_t depth;
     MOV_CHECK(read_uint16(&depth));
-    indent(2);
-    printf("depth: %u\n", depth);
+    out_field_uint("depth", depth);
 
     uint16_t color_table_id;
     MOV_CHECK(read_uint16(&color_table_id));
-    indent(2);
-    printf("color_table_id: 0x%04x\n", color_table_id);
+    out_field_hex("color_table_id", color_table_id, 4);
 
     // extensions
     while (CURRENT_ATOM.rem_size > end_atom_rem_size + 8) {
@@ -1940,23 +3772,19 @@ static uint32_t dump_mp4_es_descriptor(uint32_t length)
     MOV_CHECK(length >= 3);
 
     indent(4 * mp4_object_desc_level + 2);
-    printf("es_descriptor:\n");
+    out_printf("es_descriptor:\n");
+    out_object_begin("es_descriptor", 4 * mp4_object_desc_level + 4);
 
     uint16_t es_id;
     MOV_CHECK(read_uint16(&es_id));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("es_id: 0x%04x\n", es_id);
+    out_field_hex("es_id", es_id, 4);
 
     uint8_t flag_bits;
     MOV_CHECK(read_uint8(&flag_bits));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("stream_dep_flag: %u\n", !!(flag_bits & 0x80));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("url_flag: %u\n", !!(flag_bits & 0x40));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("reserved: %u\n", !!(flag_bits & 0x20));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("stream_priority: 0x%02x\n", flag_bits & 0x1f);
+    out_field_uint("stream_dep_flag", !!(flag_bits & 0x80));
+    out_field_uint("url_flag", !!(flag_bits & 0x40));
+    out_field_uint("reserved", !!(flag_bits & 0x20));
+    out_field_hex("stream_priority", flag_bits & 0x1f, 2);
 
     uint32_t rem_length = length - 3;
 
@@ -1964,8 +3792,7 @@ static uint32_t dump_mp4_es_descriptor(uint32_t length)
         MOV_CHECK(rem_length >= 2);
         uint16_t dependson_es_id;
         MOV_CHECK(read_uint16(&dependson_es_id));
-        indent(4 * mp4_object_desc_level + 4);
-        printf("dependson_es_id: 0x%04x\n", dependson_es_id);
+        out_field_hex("dependson_es_id", dependson_es_id, 4);
         rem_length -= 2;
     }
 
@@ -1975,17 +3802,20 @@ static uint32_t dump_mp4_es_descriptor(uint32_t length)
         MOV_CHECK(read_uint8(&url_len));
         rem_length--;
         MOV_CHECK(rem_length >= url_len);
-        indent(4 * mp4_object_desc_level + 4);
-        printf("url: ");
+        out_field_begin("url");
         dump_string(url_len, 2);
         rem_length -= url_len;
     }
 
+    out_array_begin("descriptors");
     while (rem_length > 0) {
         mp4_object_desc_level++;
         rem_length -= dump_mp4_object_descriptor(rem_length);
         mp4_object_desc_level--;
     }
+    out_array_end();
+
+    out_object_end();
 
     return length;
 }
@@ -1995,43 +3825,41 @@ static uint32_t dump_mp4_dc_descriptor(uint32_t length)
     MOV_CHECK(length >= 13);
 
     indent(4 * mp4_object_desc_level + 2);
-    printf("decoder_config:\n");
+    out_printf("decoder_config:\n");
+    out_object_begin("decoder_config", 4 * mp4_object_desc_level + 4);
 
     uint8_t obj_profile_indication;
     MOV_CHECK(read_uint8(&obj_profile_indication));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("obj_profile_indication: 0x%02x\n", obj_profile_indication);
+    out_field_hex("obj_profile_indication", obj_profile_indication, 2);
 
     uint8_t stream_bits;
     MOV_CHECK(read_uint8(&stream_bits));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("stream_type: 0x%02x\n", stream_bits >> 2);
-    indent(4 * mp4_object_desc_level + 4);
-    printf("up_stream: %u\n", !!(stream_bits & 0x02));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("reserved: %u\n", !!(stream_bits & 0x01));
+    out_field_hex("stream_type", stream_bits >> 2, 2);
+    out_field_uint("up_stream", !!(stream_bits & 0x02));
+    out_field_uint("reserved", !!(stream_bits & 0x01));
 
     uint32_t buffer_size_db;
     MOV_CHECK(read_uint24(&buffer_size_db));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("buffer_size_db: %u\n", buffer_size_db);
+    out_field_uint("buffer_size_db", buffer_size_db);
 
     uint32_t max_bitrate;
     MOV_CHECK(read_uint32(&max_bitrate));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("max_bitrate: %u\n", max_bitrate);
+    out_field_uint("max_bitrate", max_bitrate);
 
     uint32_t avg_bitrate;
     MOV_CHECK(read_uint32(&avg_bitrate));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("avg_bitrate: %u\n", avg_bitrate);
+    out_field_uint("avg_bitrate", avg_bitrate);
 
     uint32_t rem_length = length - 13;
+    out_array_begin("descriptors");
     while (rem_length > 0) {
         mp4_object_desc_level++;
         rem_length -= dump_mp4_object_descriptor(rem_length);
         mp4_object_desc_level--;
     }
+    out_array_end();
+
+    out_object_end();
 
     return length;
 }
@@ -2039,8 +3867,9 @@ static uint32_t dump_mp4_dc_descriptor(uint32_t length)
 static uint32_t dump_mp4_ds_info(uint32_t length)
 {
     indent(4 * mp4_object_desc_level + 2);
-    printf("decoder_specific_info:\n");
+    out_printf("decoder_specific_info:\n");
 
+    out_key("decoder_specific_info");
     dump_bytes(length, 4 * mp4_object_desc_level + 4);
 
     return length;
@@ -2051,15 +3880,19 @@ static uint32_t dump_mp4_slc_descriptor(uint32_t length)
     MOV_CHECK(length >= 1);
 
     indent(4 * mp4_object_desc_level + 2);
-    printf("sl_config:\n");
+    out_printf("sl_config:\n");
+    out_object_begin("sl_config", 4 * mp4_object_desc_level + 4);
 
     uint8_t predefined;
     MOV_CHECK(read_uint8(&predefined));
-    indent(4 * mp4_object_desc_level + 4);
-    printf("predefined: 0x%02x\n", predefined);
+    out_field_hex("predefined", predefined, 2);
 
-    if (length > 1)
+    if (length > 1) {
+        out_key("data");
         dump_bytes(length - 1, 4 * mp4_object_desc_level + 6);
+    }
+
+    out_object_end();
 
     return length;
 }
@@ -2069,14 +3902,14 @@ static uint32_t dump_mp4_object_descriptor(uint32_t parent_length)
     MOV_CHECK(parent_length >= 2);
 
     indent(4 * mp4_object_desc_level);
-    printf("descriptor:\n");
+    out_printf("descriptor:\n");
+    out_object_begin(0, 4 * mp4_object_desc_level + 2);
 
     uint32_t head_length = 0;
 
     uint8_t tag;
     MOV_CHECK(read_uint8(&tag));
-    indent(4 * mp4_object_desc_level + 2);
-    printf("tag: 0x%02x\n", tag);
+    out_field_hex("tag", tag, 2);
     head_length++;
 
     uint32_t length = 0;
@@ -2087,8 +3920,7 @@ static uint32_t dump_mp4_object_descriptor(uint32_t parent_length)
         length <<= 7;
         length |= byte & 0x7f;
     } while (byte & 0x80);
-    indent(4 * mp4_object_desc_level + 2);
-    printf("length: %u\n", length);
+    out_field_uint("length", length);
 
     MOV_CHECK(parent_length >= head_length + length);
 
@@ -2108,11 +3940,14 @@ static uint32_t dump_mp4_object_descriptor(uint32_t parent_length)
             used_length = dump_mp4_slc_descriptor(length);
             break;
         default:
+            out_key("data");
             dump_bytes(length, 4 * mp4_object_desc_level + 4);
             used_length = length;
             break;
     }
 
+    out_object_end();
+
     return head_length + used_length;
 }
 
@@ -2127,8 +3962,10 @@ static void dump_esds_atom()
         return;
     }
 
+    out_array_begin("descriptors");
     while (CURRENT_ATOM.rem_size > 2)
         dump_mp4_object_descriptor((uint32_t)CURRENT_ATOM.rem_size);
+    out_array_end();
 }
 
 static uint32_t dump_stbl_soun(uint32_t size)
@@ -2144,68 +3981,56 @@ static uint32_t dump_stbl_soun(uint32_t size)
 
     uint16_t version;
     MOV_CHECK(read_uint16(&version));
-    indent(2);
-    printf("version: %u\n", version);
+    out_field_uint("version", version);
 
     uint16_t revision;
     MOV_CHECK(read_uint16(&revision));
-    indent(2);
-    printf("revision: 0x%04x\n", revision);
+    out_field_hex("revision", revision, 4);
 
     uint32_t vendor;
     MOV_CHECK(read_uint32(&vendor));
-    indent(2);
-    printf("vendor: ");
+    out_field_begin("vendor");
     dump_uint32_chars(vendor);
-    printf("\n");
+    out_field_end();
 
     uint16_t channel_count;
     MOV_CHECK(read_uint16(&channel_count));
-    indent(2);
-    printf("channel_count: %u\n", channel_count);
+    out_field_uint("channel_count", channel_count);
 
     uint16_t sample_size;
     MOV_CHECK(read_uint16(&sample_size));
-    indent(2);
-    printf("sample_size: %u\n", sample_size);
+    out_field_uint("sample_size", sample_size);
 
     int16_t compression_id;
     MOV_CHECK(read_int16(&compression_id));
-    indent(2);
-    printf("compression_id: %d\n", compression_id);
+    out_field_int("compression_id", compression_id);
 
     uint16_t packet_size;
     MOV_CHECK(read_uint16(&packet_size));
-    indent(2);
-    printf("packet_size: %u\n", packet_size);
+    out_field_uint("packet_size", packet_size);
 
     uint32_t sample_rate;
     MOV_CHECK(read_uint32(&sample_rate));
-    indent(2);
-    printf("sample_rate: ");
+    out_field_begin("sample_rate");
     dump_uint32_fp(sample_rate, 16);
-    printf("\n");
+    out_field_end();
 
     if (version == 1) {
         uint32_t samples_per_packet;
         MOV_CHECK(read_uint32(&samples_per_packet));
-        indent(2);
-        printf("samples_per_packet: %u\n", samples_per_packet);
+        out_field_uint("samples_per_packet", samples_per_packet);
 
         uint32_t bytes_per_packet;
         MOV_CHECK(read_uint32(&bytes_per_packet));
-        indent(2);
-        printf("bytes_per_packet: %u\n", bytes_per_packet);
+        out_field_uint("bytes_per_packet", bytes_per_packet);
 
         uint32_t bytes_per_frame;
         MOV_CHECK(read_uint32(&bytes_per_frame));
-        indent(2);
-        printf("bytes_per_frame: %u\n", bytes_per_frame);
+        out_field_uint("bytes_per_frame", bytes_per_frame);
 
         uint32_t bytes_per_sample;
         MOV_CHECK(read_uint32(&bytes_per_sample));
-        indent(2);
-        printf("bytes_per_sample: %u\n", bytes_per_sample);
+        out_field_uint("bytes_per_sample", bytes_per_sample);
     }
 
     // extensions
@@ -2238,33 +4063,31 @@ static uint32_t dump_stbl_tmcd(uint32_t size)
 
     uint32_t reserved1;
     MOV_CHECK(read_uint32(&reserved1));
-    indent(2);
-    printf("reserved: 0x%08x\n", reserved1);
+    out_field_begin("reserved", "reserved_1");
+    out_hex(reserved1, 8);
+    out_field_end();
 
     uint32_t flags;
     MOV_CHECK(read_uint32(&flags));
-    indent(2);
-    printf("flags: 0x%08x\n", flags);
+    out_field_hex("flags", flags, 8);
 
     uint32_t timescale;
     MOV_CHECK(read_uint32(&timescale));
-    indent(2);
-    printf("timescale: %u\n", timescale);
+    out_field_uint("timescale", timescale);
 
     int32_t frame_duration;
     MOV_CHECK(read_int32(&frame_duration));
-    indent(2);
-    printf("frame_duration: %d (%f sec)\n", frame_duration, get_duration_sec(frame_duration, timescale));
+    out_field_duration("frame_duration", frame_duration, timescale);
 
     uint8_t number_of_frames;
     MOV_CHECK(read_uint8(&number_of_frames));
-    indent(2);
-    printf("number_of_frames: %u\n", number_of_frames);
+    out_field_uint("number_of_frames", number_of_frames);
 
     uint8_t reserved2;
     MOV_CHECK(read_uint8(&reserved2));
-    indent(2);
-    printf("reserved: 0x%02x\n", reserved2);
+    out_field_begin("reserved", "reserved_2");
+    out_hex(reserved2, 2);
+    out_field_end();
 
     // extensions
     while (CURRENT_ATOM.rem_size > end_atom_rem_size + 8) {
@@ -2297,36 +4120,39 @@ static void dump_stsd_atom()
     uint32_t num_entries;
     MOV_CHECK(read_uint32(&num_entries));
     indent();
-    printf("sample_descriptions (");
+    out_printf("sample_descriptions (");
+    out_key("num_sample_descriptions");
     dump_uint32(num_entries, true);
-    printf("):\n");
+    out_printf("):\n");
 
     uint32_t i;
+    out_array_begin("sample_descriptions", 2);
     for (i = 0; i < num_entries; i++) {
+        out_object_begin(0, 2);
+
         uint32_t size;
         MOV_CHECK(read_uint32(&size));
-        indent(2);
-        printf("size: %08x\n", size);
+        out_field_begin("size");
+        out_hex(size, 8, "");
+        out_field_end();
         MOV_CHECK(size >= 16);
 
         uint32_t data_format;
         MOV_CHECK(read_uint32(&data_format));
-        indent(2);
-        printf("data_format: ");
+        g_sample_entry_type = data_format;
+        out_field_begin("data_format");
         dump_uint32_chars(data_format);
-        printf("\n");
+        out_field_end();
 
         unsigned char reserved[6];
         MOV_CHECK(read_bytes(reserved, 6));
-        indent(2);
-        printf("reserved: ");
+        out_field_begin("reserved");
         dump_inline_bytes(reserved, 6);
-        printf("\n");
+        out_field_end();
 
         uint16_t data_ref_index;
         MOV_CHECK(read_uint16(&data_ref_index));
-        indent(2);
-        printf("data_ref_index: 0x%04x\n", data_ref_index);
+        out_field_hex("data_ref_index", data_ref_index, 4);
 
         uint32_t rem_size = size - 16;
         if (g_component_type == MHLR_COMPONENT_TYPE || (!g_component_type && !g_qt_brand)) {
@@ -2339,10 +4165,17 @@ static void dump_stsd_atom()
         }
         if (rem_size > 0) {
             indent(2);
-            printf("remainder...: %u unparsed bytes\n", rem_size);
+            out_printf("remainder...: ");
+            out_key("unparsed_size");
+            out_uint(rem_size);
+            out_printf(" unparsed bytes\n");
+            out_key("unparsed_data");
             dump_bytes(rem_size, 4);
         }
+
+        out_object_end();
     }
+    out_array_end();
 }
 
 static void dump_stbl_atom()
@@ -2362,6 +4195,7 @@ static void dump_stbl_atom()
         {{'c','o','6','4'}, dump_co64_atom},
     };
 
+    reset_sample_table_state();
     dump_container_atom(dump_func_map, DUMP_FUNC_MAP_SIZE);
 }
 
@@ -2381,8 +4215,8 @@ static void dump_vmhd_atom()
     uint32_t flags;
     dump_full_atom_header(&version, &flags, false);
     if ((flags & 0x0001))
-        printf(" (no lean ahead)");
-    printf("\n");
+        out_printf(" (no lean ahead)");
+    out_field_end();
 
     if (version != 0x00) {
         dump_unknown_version(version);
@@ -2392,17 +4226,17 @@ static void dump_vmhd_atom()
 
     uint16_t graphics_mode;
     MOV_CHECK(read_uint16(&graphics_mode));
-    indent();
-    printf("graphics_mode: %02x\n", graphics_mode);
+    out_field_begin("graphics_mode");
+    out_hex(graphics_mode, 2, "");
+    out_field_end();
 
     uint16_t opcolor_r, opcolor_g, opcolor_b;
     MOV_CHECK(read_uint16(&opcolor_r));
     MOV_CHECK(read_uint16(&opcolor_g));
     MOV_CHECK(read_uint16(&opcolor_b));
-    indent();
-    printf("opcolor: ");
+    out_field_begin("opcolor");
     dump_color(opcolor_r, opcolor_g, opcolor_b);
-    printf("\n");
+    out_field_end();
 }
 
 static void dump_smhd_atom()
@@ -2419,17 +4253,15 @@ static void dump_smhd_atom()
 
     int16_t balance;
     MOV_CHECK(read_int16(&balance));
-    indent();
-    printf("balance: ");
+    out_field_begin("balance");
     dump_int16_fp(balance, 8);
-    printf("\n");
+    out_field_end();
 
     uint16_t reserved;
     MOV_CHECK(read_uint16(&reserved));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved");
     dump_uint16(reserved, true);
-    printf("\n");
+    out_field_end();
 }
 
 static void dump_gmin_atom()
@@ -2438,8 +4270,8 @@ static void dump_gmin_atom()
     uint32_t flags;
     dump_full_atom_header(&version, &flags, false);
     if ((flags & 0x0001))
-        printf(" (no lean ahead)");
-    printf("\n");
+        out_printf(" (no lean ahead)");
+    out_field_end();
 
     if (version != 0x00) {
         dump_unknown_version(version);
@@ -2449,31 +4281,29 @@ static void dump_gmin_atom()
 
     uint16_t graphics_mode;
     MOV_CHECK(read_uint16(&graphics_mode));
-    indent();
-    printf("graphics_mode: %02x\n", graphics_mode);
+    out_field_begin("graphics_mode");
+    out_hex(graphics_mode, 2, "");
+    out_field_end();
 
     uint16_t opcolor_r, opcolor_g, opcolor_b;
     MOV_CHECK(read_uint16(&opcolor_r));
     MOV_CHECK(read_uint16(&opcolor_g));
     MOV_CHECK(read_uint16(&opcolor_b));
-    indent();
-    printf("opcolor: ");
+    out_field_begin("opcolor");
     dump_color(opcolor_r, opcolor_g, opcolor_b);
-    printf("\n");
+    out_field_end();
 
     int16_t balance;
     MOV_CHECK(read_int16(&balance));
-    indent();
-    printf("balance: ");
+    out_field_begin("balance");
     dump_int16_fp(balance, 8);
-    printf("\n");
+    out_field_end();
 
     uint16_t reserved;
     MOV_CHECK(read_uint16(&reserved));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved");
     dump_uint16(reserved, true);
-    printf("\n");
+    out_field_end();
 }
 
 static void dump_tcmi_atom()
@@ -2482,8 +4312,8 @@ static void dump_tcmi_atom()
     uint32_t flags;
     dump_full_atom_header(&version, &flags, false);
     if ((flags & 0x0001))
-        printf(" (no lean ahead)");
-    printf("\n");
+        out_printf(" (no lean ahead)");
+    out_field_end();
 
     if (version != 0x00) {
         dump_unknown_version(version);
@@ -2493,43 +4323,41 @@ static void dump_tcmi_atom()
 
     uint16_t text_font;
     MOV_CHECK(read_uint16(&text_font));
-    indent();
-    printf("text_font: %02x\n", text_font);
+    out_field_begin("text_font");
+    out_hex(text_font, 2, "");
+    out_field_end();
 
     uint16_t text_face;
     MOV_CHECK(read_uint16(&text_face));
-    indent();
-    printf("text_face: %02x\n", text_face);
+    out_field_begin("text_face");
+    out_hex(text_face, 2, "");
+    out_field_end();
 
     uint32_t text_size;
     MOV_CHECK(read_uint32(&text_size));
-    indent();
-    printf("text_size: ");
+    out_field_begin("text_size");
     dump_uint32_fp(text_size, 16);
-    printf("\n");
+    out_field_end();
 
     uint16_t text_color_r, text_color_g, text_color_b;
     MOV_CHECK(read_uint16(&text_color_r));
     MOV_CHECK(read_uint16(&text_color_g));
     MOV_CHECK(read_uint16(&text_color_b));
-    indent();
-    printf("text_color: ");
+    out_field_begin("text_color");
     dump_color(text_color_r, text_color_g, text_color_b);
-    printf("\n");
+    out_field_end();
 
     uint16_t bg_color_r, bg_color_g, bg_color_b;
     MOV_CHECK(read_uint16(&bg_color_r));
     MOV_CHECK(read_uint16(&bg_color_g));
     MOV_CHECK(read_uint16(&bg_color_b));
-    indent();
-    printf("background_color: ");
+    out_field_begin("background_color");
     dump_color(bg_color_r, bg_color_g, bg_color_b);
-    printf("\n");
+    out_field_end();
 
     uint8_t font_name_size;
     MOV_CHECK(read_uint8(&font_name_size));
-    indent();
-    printf("font_name: ");
+    out_field_begin("font_name");
     dump_string(font_name_size, 2);
 }
 
@@ -2584,61 +4412,53 @@ static void dump_mdhd_atom()
     if (version == 0x00) {
         uint32_t creation_time;
         MOV_CHECK(read_uint32(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint32_t modification_time;
         MOV_CHECK(read_uint32(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     } else {
         uint64_t creation_time;
         MOV_CHECK(read_uint64(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint64_t modification_time;
         MOV_CHECK(read_uint64(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     }
 
     uint32_t timescale;
     MOV_CHECK(read_uint32(&timescale));
-    indent();
-    printf("timescale: %u\n", timescale);
+    out_field_uint("timescale", timescale);
+    g_media_timescale = timescale;
 
     if (version == 0x00) {
         int32_t duration;
         MOV_CHECK(read_int32(&duration));
-        indent();
-        printf("duration: %d (%f sec)\n", duration, get_duration_sec(duration, timescale));
+        out_field_duration("duration", duration, timescale);
     } else {
         int64_t duration;
         MOV_CHECK(read_int64(&duration));
-        indent();
-        printf("duration: %" PRId64 " (%f sec)\n", duration, get_duration_sec(duration, timescale));
+        out_field_duration("duration", duration, timescale);
     }
 
     uint16_t language;
     MOV_CHECK(read_uint16(&language));
-    indent();
-    printf("language: ");
+    out_field_begin("language");
     dump_language(language);
-    printf("\n");
+    out_field_end();
 
     uint16_t quality;
     MOV_CHECK(read_uint16(&quality));
-    indent();
-    printf("quality: %u\n", quality);
+    out_field_uint("quality", quality);
 }
 
 static void dump_mdia_atom()
@@ -2673,13 +4493,16 @@ static void dump_keys_atom()
     MOV_CHECK(read_uint32(&count));
 
     indent();
-    printf("key_values (");
+    out_printf("key_values (");
+    out_key("num_key_values");
     dump_uint32(count, false);
-    printf("):\n");
+    out_printf("):\n");
 
     unsigned char key_value_buffer[129];
     uint32_t total_count = 0;
+    out_array_begin("key_values", 2);
     for (total_count = 0; total_count < count; total_count++) {
+        out_object_begin(0, 2);
         indent(2);
 
         uint32_t key_size;
@@ -2689,7 +4512,8 @@ static void dump_keys_atom()
         uint32_t key_namespace;
         MOV_CHECK(read_uint32(&key_namespace));
 
-        printf("%4u  ", total_count + 1);
+        out_printf("%4u  ", total_count + 1);
+        out_key("size");
         dump_uint32(key_size, true);
 
         key_value_size = key_size - 8;
@@ -2704,23 +4528,36 @@ static void dump_keys_atom()
             }
             if (i >= key_value_size) {
                 key_value_buffer[key_value_size] = '\0';
-                printf("  mdta  '%s'\n", (char*)key_value_buffer);
+                out_printf("  ");
+                out_key("namespace");
+                dump_uint32_tag(key_namespace);
+                out_printf("  '");
+                out_key("value");
+                out_string((char*)key_value_buffer);
+                out_printf("'\n");
                 g_meta_keys.push_back((char*)key_value_buffer);
             } else {
-                printf("  ");
+                out_printf("  ");
+                out_key("namespace");
                 dump_uint32_chars(key_namespace);
-                printf("\n");
+                out_printf("\n");
+                out_key("value");
                 dump_bytes(key_value_buffer, key_value_size, 4);
                 g_meta_keys.push_back("");
             }
         } else {
-            printf("  ");
+            out_printf("  ");
+            out_key("namespace");
             dump_uint32_chars(key_namespace);
-            printf("\n");
+            out_printf("\n");
+            out_key("value");
             dump_bytes(key_value_size, 4);
             g_meta_keys.push_back("");
         }
+
+        out_object_end();
     }
+    out_array_end();
 }
 
 static void dump_ilst_data_atom()
@@ -2732,20 +4569,20 @@ static void dump_ilst_data_atom()
     MOV_CHECK(read_uint8(&type_field_1));
     MOV_CHECK(read_uint24(&type_field_2));
 
-    indent();
-    printf("type 1: %u\n", type_field_1);
-    indent();
-    printf("type 2: %u\n", type_field_2);
+    out_field_begin("type 1", "type_1");
+    out_uint(type_field_1);
+    out_field_end();
+    out_field_begin("type 2", "type_2");
+    out_uint(type_field_2);
+    out_field_end();
 
     uint16_t locale;
     uint16_t country;
     MOV_CHECK(read_uint16(&locale));
     MOV_CHECK(read_uint16(&country));
 
-    indent();
-    printf("locale: %u\n", locale);
-    indent();
-    printf("country: %u\n", country);
+    out_field_uint("locale", locale);
+    out_field_uint("country", country);
 
     indent();
     if (type_field_1 == 0 &&
@@ -2757,57 +4594,92 @@ static void dump_ilst_data_atom()
             if (CURRENT_ATOM.rem_size == 8) {
                 int64_t value;
                 MOV_CHECK(read_int64(&value));
-                printf("value (int64): %" PRId64 "\n", value);
+                out_printf("value (int64): ");
+                out_key("value");
+                out_int(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 4) {
                 int32_t value;
                 MOV_CHECK(read_int32(&value));
-                printf("value (int32): %d\n", value);
+                out_printf("value (int32): ");
+                out_key("value");
+                out_int(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 3) {
                 int32_t value;
                 MOV_CHECK(read_int24(&value));
-                printf("value (int24): %d\n", value);
+                out_printf("value (int24): ");
+                out_key("value");
+                out_int(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 2) {
                 int16_t value;
                 MOV_CHECK(read_int16(&value));
-                printf("value (int16): %d\n", value);
+                out_printf("value (int16): ");
+                out_key("value");
+                out_int(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 1) {
                 int8_t value;
                 MOV_CHECK(read_int8(&value));
-                printf("value (int8): %d\n", value);
+                out_printf("value (int8): ");
+                out_key("value");
+                out_int(value);
+                out_printf("\n");
             } else {
-                printf("value:\n");
+                out_printf("value:\n");
+                out_key("value");
                 dump_bytes(CURRENT_ATOM.rem_size, 4);
             }
         } else if (type_field_2 == 22) {
             if (CURRENT_ATOM.rem_size == 8) {
                 uint64_t value;
                 MOV_CHECK(read_uint64(&value));
-                printf("value (uint64): %" PRIu64 "\n", value);
+                out_printf("value (uint64): ");
+                out_key("value");
+                out_uint(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 4) {
                 uint32_t value;
                 MOV_CHECK(read_uint32(&value));
-                printf("value (uint32): %u\n", value);
+                out_printf("value (uint32): ");
+                out_key("value");
+                out_uint(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 3) {
                 uint32_t value;
                 MOV_CHECK(read_uint24(&value));
-                printf("value (uint24): %u\n", value);
+                out_printf("value (uint24): ");
+                out_key("value");
+                out_uint(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 2) {
                 uint16_t value;
                 MOV_CHECK(read_uint16(&value));
-                printf("value (uint16): %u\n", value);
+                out_printf("value (uint16): ");
+                out_key("value");
+                out_uint(value);
+                out_printf("\n");
             } else if (CURRENT_ATOM.rem_size == 1) {
                 uint8_t value;
                 MOV_CHECK(read_uint8(&value));
-                printf("value (uint8): %u\n", value);
+                out_printf("value (uint8): ");
+                out_key("value");
+                out_uint(value);
+                out_printf("\n");
             } else {
-                printf("value:\n");
+                out_printf("value:\n");
+                out_key("value");
                 dump_bytes(CURRENT_ATOM.rem_size, 4);
             }
         } else {    // type_field_2 == 1
             uint64_t utf8_value_size = CURRENT_ATOM.rem_size;
             unsigned char utf8_value_buffer[129];
             if (utf8_value_size == 0) {
-                printf("value: ''\n");
+                out_printf("value: '");
+                out_key("value");
+                out_string("");
+                out_printf("'\n");
             } else if (utf8_value_size < sizeof(utf8_value_buffer)) {
                 MOV_CHECK(read_bytes(utf8_value_buffer, (uint32_t)utf8_value_size));
 
@@ -2818,20 +4690,26 @@ static void dump_ilst_data_atom()
                 }
                 if (i >= utf8_value_size) {
                     utf8_value_buffer[utf8_value_size] = '\0';
-                    printf("value: '%s'\n", (char*)utf8_value_buffer);
+                    out_printf("value: '");
+                    out_key("value");
+                    out_string((char*)utf8_value_buffer);
+                    out_printf("'\n");
                 } else {
-                    printf("value:\n");
+                    out_printf("value:\n");
+                    out_key("value");
                     dump_bytes(utf8_value_buffer, utf8_value_size, 4);
                 }
             } else {
-                printf("value:\n");
+                out_printf("value:\n");
+                out_key("value");
                 dump_bytes(utf8_value_size, 4);
             }
         }
     }
     else
     {
-        printf("value:\n");
+        out_printf("value:\n");
+        out_key("value");
         dump_bytes(CURRENT_ATOM.rem_size, 4);
     }
 }
@@ -2845,24 +4723,30 @@ static void dump_ilst_atom()
 
     dump_atom_header();
 
+    out_array_begin("items");
     while (CURRENT_ATOM.rem_size > 0) {
+        out_object_begin();
+
         uint32_t element_size;
         MOV_CHECK(read_uint32(&element_size));
         uint32_t key_index;
         MOV_CHECK(read_uint32(&key_index));
         MOV_CHECK(key_index >= 1 && (g_meta_keys.empty() || key_index <= g_meta_keys.size()));
 
-        indent();
-        printf("size: ");
+        out_field_begin("size");
         dump_uint32_size(element_size);
-        printf("\n");
-        indent();
-        printf("key_index: %u", key_index);
+        out_field_end();
+        out_field_begin("key_index");
+        out_uint(key_index);
         if (!g_meta_keys.empty()) {
-            if (!g_meta_keys[key_index - 1].empty())
-                printf(" ('%s')", g_meta_keys[key_index - 1].c_str());
+            if (!g_meta_keys[key_index - 1].empty()) {
+                out_printf(" ('");
+                out_key("key");
+                out_string(g_meta_keys[key_index - 1].c_str());
+                out_printf("')");
+            }
         }
-        printf("\n");
+        out_field_end();
 
 
         push_atom();
@@ -2873,7 +4757,10 @@ static void dump_ilst_atom()
         dump_child_atom(dump_func_map, DUMP_FUNC_MAP_SIZE);
 
         pop_atom();
+
+        out_object_end();
     }
+    out_array_end();
 }
 
 static void dump_clefprofenof_atom()
@@ -2890,17 +4777,15 @@ static void dump_clefprofenof_atom()
 
     uint32_t fp_width;
     MOV_CHECK(read_uint32(&fp_width));
-    indent();
-    printf("width: ");
+    out_field_begin("width");
     dump_uint32_fp(fp_width, 16);
-    printf("\n");
+    out_field_end();
 
     uint32_t fp_height;
     MOV_CHECK(read_uint32(&fp_height));
-    indent();
-    printf("height: ");
+    out_field_begin("height");
     dump_uint32_fp(fp_height, 16);
-    printf("\n");
+    out_field_end();
 }
 
 static void dump_tapt_atom()
@@ -2922,18 +4807,12 @@ static void dump_tref_child_atom()
     uint32_t count = (uint32_t)(CURRENT_ATOM.rem_size / 4);
 
     indent();
-    printf("track_ids (");
+    out_printf("track_ids (");
+    out_key("num_track_ids");
     dump_uint32(count, false);
-    printf("):\n");
+    out_printf("):\n");
 
-    indent(4);
-    if (count < 0xffff)
-        printf("   i");
-    else if (count < 0xffffff)
-        printf("     i");
-    else
-        printf("       i");
-    printf("          id\n");
+    out_table_begin("track_ids", count, "          id");
 
 
     uint32_t i;
@@ -2944,10 +4823,11 @@ static void dump_tref_child_atom()
         indent(4);
         dump_uint32_index(count, i);
 
-        printf("  ");
+        out_printf("  ");
         dump_uint32(track_id, true);
     }
-    printf("\n");
+    out_printf("\n");
+    out_table_end();
 }
 
 static void dump_tref_atom()
@@ -2976,37 +4856,31 @@ static void dump_elst_atom()
     MOV_CHECK(read_uint32(&count));
 
     indent();
-    printf("edit_list_table (");
+    out_printf("edit_list_table (");
+    out_key("num_entries");
     dump_uint32(count, false);
-    printf("):\n");
+    out_printf("):\n");
 
-    indent(4);
-    if (count < 0xffff)
-        printf("   i");
-    else if (count < 0xffffff)
-        printf("     i");
-    else
-        printf("       i");
     if (version == 0)
-        printf("    duration       time          rate\n");
+        out_table_begin("entries", count, "    duration       time          rate");
     else
-        printf("              duration                 time          rate\n");
+        out_table_begin("entries", count, "              duration                 time          rate");
 
 
     uint32_t i = 0;
     for (i = 0; i < count; i++) {
-        indent(4);
-        dump_uint32_index(count, i);
+        out_row_begin(count, i);
         if (version == 0) {
             uint32_t track_duration;
             MOV_CHECK(read_uint32(&track_duration));
             int32_t media_time;
             MOV_CHECK(read_int32(&media_time));
 
-            printf("  ");
+            out_key("duration");
             dump_uint32(track_duration, false);
 
-            printf(" ");
+            out_printf(" ");
+            out_key("time");
             dump_int32(media_time);
         } else {
             uint64_t track_duration;
@@ -3014,20 +4888,23 @@ static void dump_elst_atom()
             int64_t media_time;
             MOV_CHECK(read_int64(&media_time));
 
-            printf("  ");
+            out_key("duration");
             dump_uint64(track_duration, false);
 
-            printf(" ");
+            out_printf(" ");
+            out_key("time");
             dump_int64(media_time);
         }
 
         uint32_t media_rate;
         MOV_CHECK(read_uint32(&media_rate));
 
-        printf("      ");
+        out_printf("      ");
+        out_key("rate");
         dump_uint32_fp(media_rate, 16);
-        printf("\n");
+        out_row_end();
     }
+    out_table_end();
 }
 
 static void dump_edts_atom()
@@ -3067,107 +4944,93 @@ static void dump_tkhd_atom()
     if (version == 0x00) {
         uint32_t creation_time;
         MOV_CHECK(read_uint32(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint32_t modification_time;
         MOV_CHECK(read_uint32(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     } else {
         uint64_t creation_time;
         MOV_CHECK(read_uint64(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint64_t modification_time;
         MOV_CHECK(read_uint64(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     }
 
     uint32_t track_id;
     MOV_CHECK(read_uint32(&track_id));
-    indent();
-    printf("track_id: %u\n", track_id);
+    out_field_uint("track_id", track_id);
 
     uint32_t reserved_uint32;
     MOV_CHECK(read_uint32(&reserved_uint32));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved", "reserved_1");
     dump_uint32(reserved_uint32, true);
-    printf("\n");
+    out_field_end();
 
     if (version == 0x00) {
         int32_t duration;
         MOV_CHECK(read_int32(&duration));
-        indent();
-        printf("duration: %d (%f sec)\n", duration, get_duration_sec(duration, g_movie_timescale));
+        out_field_duration("duration", duration, g_movie_timescale);
     } else {
         int64_t duration;
         MOV_CHECK(read_int64(&duration));
-        indent();
-        printf("duration: %" PRId64 " (%f sec)\n", duration, get_duration_sec(duration, g_movie_timescale));
+        out_field_duration("duration", duration, g_movie_timescale);
     }
 
     unsigned char reserved_bytes[8];
     MOV_CHECK(read_bytes(reserved_bytes, 8));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved", "reserved_2");
     dump_inline_bytes(reserved_bytes, 8);
-    printf("\n");
+    out_field_end();
 
     uint16_t layer;
     MOV_CHECK(read_uint16(&layer));
-    indent();
-    printf("layer: %u\n", layer);
+    out_field_uint("layer", layer);
 
     uint16_t alternate_group;
     MOV_CHECK(read_uint16(&alternate_group));
-    indent();
-    printf("alternate_group: %u\n", alternate_group);
+    out_field_uint("alternate_group", alternate_group);
 
     uint16_t volume;
     MOV_CHECK(read_uint16(&volume));
-    indent();
-    printf("volume: ");
+    out_field_begin("volume");
     dump_uint16_fp(volume, 8);
-    printf("\n");
+    out_field_end();
 
     uint16_t reserved_uint16;
     MOV_CHECK(read_uint16(&reserved_uint16));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved", "reserved_3");
     dump_uint16(reserved_uint16, true);
-    printf("\n");
+    out_field_end();
 
     uint32_t matrix[9];
     MOV_CHECK(read_matrix(matrix));
     indent();
-    printf("matrix: \n");
+    out_printf("matrix: \n");
+    out_key("matrix");
     dump_matrix(matrix, 2);
 
     uint32_t track_width;
     MOV_CHECK(read_uint32(&track_width));
-    indent();
-    printf("track_width: ");
+    out_field_begin("track_width");
     dump_uint32_fp(track_width, 16);
-    printf("\n");
+    out_field_end();
 
     uint32_t track_height;
     MOV_CHECK(read_uint32(&track_height));
-    indent();
-    printf("track_height: ");
+    out_field_begin("track_height");
     dump_uint32_fp(track_height, 16);
-    printf("\n");
+    out_field_end();
 }
 
 static void dump_udta_name_atom()
@@ -3175,7 +5038,11 @@ static void dump_udta_name_atom()
     dump_atom_header();
 
     indent();
-    printf("value: (len=%" PRId64 ") ", CURRENT_ATOM.rem_size);
+    out_printf("value: (len=");
+    out_key("len");
+    out_uint(CURRENT_ATOM.rem_size);
+    out_printf(") ");
+    out_key("value");
     dump_string(CURRENT_ATOM.rem_size, 2);
 }
 
@@ -3232,74 +5099,65 @@ static void dump_mvhd_atom()
     if (version == 0x00) {
         uint32_t creation_time;
         MOV_CHECK(read_uint32(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint32_t modification_time;
         MOV_CHECK(read_uint32(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     } else {
         uint64_t creation_time;
         MOV_CHECK(read_uint64(&creation_time));
-        indent();
-        printf("creation_time: ");
+        out_field_begin("creation_time");
         dump_timestamp(creation_time);
-        printf("\n");
+        out_field_end();
 
         uint64_t modification_time;
         MOV_CHECK(read_uint64(&modification_time));
-        indent();
-        printf("modification_time: ");
+        out_field_begin("modification_time");
         dump_timestamp(modification_time);
-        printf("\n");
+        out_field_end();
     }
 
     MOV_CHECK(read_uint32(&g_movie_timescale));
-    indent();
-    printf("timescale: %u\n", g_movie_timescale);
+    out_field_uint("timescale", g_movie_timescale);
 
     if (version == 0x00) {
         int32_t duration;
         MOV_CHECK(read_int32(&duration));
-        indent();
-        printf("duration: %d (%f sec)\n", duration, get_duration_sec(duration, g_movie_timescale));
+        out_field_duration("duration", duration, g_movie_timescale);
     } else {
         int64_t duration;
         MOV_CHECK(read_int64(&duration));
-        indent();
-        printf("duration: %" PRId64 " (%f sec)\n", duration, get_duration_sec(duration, g_movie_timescale));
+        out_field_duration("duration", duration, g_movie_timescale);
     }
 
     uint32_t preferred_rate;
     MOV_CHECK(read_uint32(&preferred_rate));
-    indent();
-    printf("preferred_rate: ");
+    out_field_begin("preferred_rate");
     dump_uint32_fp(preferred_rate, 16);
-    printf("\n");
+    out_field_end();
 
     uint16_t preferred_volume;
     MOV_CHECK(read_uint16(&preferred_volume));
-    indent();
-    printf("preferred_volume: ");
+    out_field_begin("preferred_volume");
     dump_uint16_fp(preferred_volume, 8);
-    printf("\n");
+    out_field_end();
 
     unsigned char bytes[10];
     MOV_CHECK(read_bytes(bytes, 10));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved");
     dump_inline_bytes(bytes, 10);
-    printf("\n");
+    out_field_end();
 
     uint32_t matrix[9];
     MOV_CHECK(read_matrix(matrix));
     indent();
-    printf("matrix: \n");
+    out_printf("matrix: \n");
+    out_key("matrix");
     dump_matrix(matrix, 2);
 
 
@@ -3307,38 +5165,31 @@ static void dump_mvhd_atom()
 
     uint32_t preview_time;
     MOV_CHECK(read_uint32(&preview_time));
-    indent();
-    printf("preview_time: %u\n", preview_time);
+    out_field_uint("preview_time", preview_time);
 
     uint32_t preview_duration;
     MOV_CHECK(read_uint32(&preview_duration));
-    indent();
-    printf("preview_duration: %u (%f sec)\n", preview_duration, get_duration_sec(preview_duration, g_movie_timescale));
+    out_field_duration("preview_duration", preview_duration, g_movie_timescale);
 
     uint32_t poster_time;
     MOV_CHECK(read_uint32(&poster_time));
-    indent();
-    printf("poster_time: %u\n", poster_time);
+    out_field_uint("poster_time", poster_time);
 
     uint32_t selection_time;
     MOV_CHECK(read_uint32(&selection_time));
-    indent();
-    printf("selection_time: %u\n", selection_time);
+    out_field_uint("selection_time", selection_time);
 
     uint32_t selection_duration;
     MOV_CHECK(read_uint32(&selection_duration));
-    indent();
-    printf("selection_duration: %u (%f sec)\n", selection_duration, get_duration_sec(selection_duration, g_movie_timescale));
+    out_field_duration("selection_duration", selection_duration, g_movie_timescale);
 
     uint32_t current_time;
     MOV_CHECK(read_uint32(&current_time));
-    indent();
-    printf("current_time: %u\n", current_time);
+    out_field_uint("current_time", current_time);
 
     uint32_t next_track_id;
     MOV_CHECK(read_uint32(&next_track_id));
-    indent();
-    printf("next_track_id: %u\n", next_track_id);
+    out_field_uint("next_track_id", next_track_id);
 }
 
 static void dump_mehd_atom()
@@ -3351,17 +5202,15 @@ static void dump_mehd_atom()
     if (version == 0) {
         uint32_t fragment_duration;
         MOV_CHECK(read_uint32(&fragment_duration));
-        indent();
-        printf("fragment_duration: ");
+        out_field_begin("fragment_duration");
         dump_uint32(fragment_duration, true);
-        printf("\n");
+        out_field_end();
     } else {
         uint64_t fragment_duration;
         MOV_CHECK(read_uint64(&fragment_duration));
-        indent();
-        printf("fragment_duration: ");
+        out_field_begin("fragment_duration");
         dump_uint64(fragment_duration, true);
-        printf("\n");
+        out_field_end();
     }
 }
 
@@ -3374,34 +5223,27 @@ static void dump_trex_atom()
 
     uint32_t track_id;
     MOV_CHECK(read_uint32(&track_id));
-    indent();
-    printf("track_id: %u\n", track_id);
+    out_field_uint("track_id", track_id);
 
     uint32_t default_sample_description_index;
     MOV_CHECK(read_uint32(&default_sample_description_index));
-    indent();
-    printf("default_sample_description_index: %u\n", default_sample_description_index);
+    out_field_uint("default_sample_description_index", default_sample_description_index);
 
     uint32_t default_sample_duration;
     MOV_CHECK(read_uint32(&default_sample_duration));
-    indent();
-    printf("default_sample_duration: ");
+    out_field_begin("default_sample_duration");
     dump_uint32(default_sample_duration, true);
-    printf("\n");
+    out_field_end();
 
     uint32_t default_sample_size;
     MOV_CHECK(read_uint32(&default_sample_size));
-    indent();
-    printf("default_sample_size: ");
+    out_field_begin("default_sample_size");
     dump_uint32(default_sample_size, true);
-    printf("\n");
+    out_field_end();
 
     uint32_t default_sample_flags;
     MOV_CHECK(read_uint32(&default_sample_flags));
-    indent();
-    printf("default_sample_flags: 0x%08x (", default_sample_flags);
-    dump_fragment_sample_flags(default_sample_flags);
-    printf(")\n");
+    out_field_sample_flags("default_sample_flags", "default_sample_flags_fields", default_sample_flags);
 }
 
 static void dump_mvex_atom()
@@ -3438,58 +5280,53 @@ static void dump_sidx_atom()
 
     uint32_t reference_id;
     MOV_CHECK(read_uint32(&reference_id));
-    indent();
-    printf("reference_id: %u\n", reference_id);
+    out_field_uint("reference_id", reference_id);
 
     uint32_t timescale;
     MOV_CHECK(read_uint32(&timescale));
-    indent();
-    printf("timescale: %u\n", timescale);
+    out_field_uint("timescale", timescale);
 
     if (version == 0x00) {
         uint32_t earliest_pres_time;
         MOV_CHECK(read_uint32(&earliest_pres_time));
-        indent();
-        printf("earliest_presentation_time: %u\n", earliest_pres_time);
+        out_field_uint("earliest_presentation_time", earliest_pres_time);
 
         uint32_t first_offset;
         MOV_CHECK(read_uint32(&first_offset));
-        indent();
-        printf("first_offset: %u\n", first_offset);
+        out_field_uint("first_offset", first_offset);
     } else {
         uint64_t earliest_pres_time;
         MOV_CHECK(read_uint64(&earliest_pres_time));
-        indent();
-        printf("earliest_presentation_time: %" PRIu64 "\n", earliest_pres_time);
+        out_field_uint("earliest_presentation_time", earliest_pres_time);
 
         uint64_t first_offset;
         MOV_CHECK(read_uint64(&first_offset));
-        indent();
-        printf("first_offset: %" PRIu64 "\n", first_offset);
+        out_field_uint("first_offset", first_offset);
     }
 
     uint16_t reserved_uint16;
     MOV_CHECK(read_uint16(&reserved_uint16));
-    indent();
-    printf("reserved: ");
+    out_field_begin("reserved");
     dump_uint16(reserved_uint16, true);
-    printf("\n");
+    out_field_end();
 
     uint16_t num_entries;
     MOV_CHECK(read_uint16(&num_entries));
     indent();
-    printf("references (");
+    out_printf("references (");
+    out_key("num_references");
     dump_uint16(num_entries, false);
-    printf("):\n");
+    out_printf("):\n");
 
     indent(4);
     if (num_entries < 0xff)
-        printf("%2s", "i");
+        out_printf("%2s", "i");
     else
-        printf("%4s", "i");
-    printf("%10s%12s%14s%16s%10s%16s\n",
+        out_printf("%4s", "i");
+    out_printf("%10s%12s%14s%16s%10s%16s\n",
            "ref_type", "ref_size",  "subseg_dur", "start_with_sap", "sap_type", "sap_delta_time");
 
+    out_array_begin("references", 4);
     uint16_t i;
     for (i = 0; i < num_entries; i++) {
         uint32_t reference_word;
@@ -3499,32 +5336,42 @@ static void dump_sidx_atom()
         uint32_t sap_word;
         MOV_CHECK(read_uint32(&sap_word));
 
+        out_object_begin(0, 4);
         indent(4);
         dump_uint16_index(num_entries, i);
 
-        if (reference_word & 0x80000000)
-            printf("%10s", "sidx");
-        else
-            printf("%10s", "media");
+        const char *reference_type = ((reference_word & 0x80000000) ? "sidx" : "media");
+        out_spaces(10 - strlen(reference_type));
+        out_key("reference_type");
+        out_string(reference_type);
 
-        printf("%*c", 2, ' ');
+        out_printf("%*c", 2, ' ');
+        out_key("reference_size");
         dump_uint32(reference_word & 0x7fffffff, true);
 
-        printf("%*c", 4, ' ');
+        out_printf("%*c", 4, ' ');
+        out_key("subsegment_duration");
         dump_uint32(subsegment_duration, true);
 
-        if (sap_word & 0x80000000)
-            printf("%16s", "true");
+        out_key("starts_with_sap");
+        if (g_json_output)
+            json_bool_value(sap_word & 0x80000000);
+        else if (sap_word & 0x80000000)
+            out_printf("%16s", "true");
         else
-            printf("%16s", "false");
+            out_printf("%16s", "false");
 
-        printf("%*c", 7, ' ');
+        out_printf("%*c", 7, ' ');
+        out_key("sap_type");
         dump_uint8((sap_word >> 28) & ((1 << 3) - 1), false);
 
-        printf("%*c", 6, ' ');
+        out_printf("%*c", 6, ' ');
+        out_key("sap_delta_time");
         dump_uint32(sap_word & ((1 << 28) - 1), false);
-        printf("\n");
+        out_printf("\n");
+        out_object_end();
     }
+    out_array_end();
 }
 
 static void dump_mfhd_atom()
@@ -3536,8 +5383,7 @@ static void dump_mfhd_atom()
 
     uint32_t sequence_number;
     MOV_CHECK(read_uint32(&sequence_number));
-    indent();
-    printf("sequence_number: %u\n", sequence_number);
+    out_field_uint("sequence_number", sequence_number);
 }
 
 static void dump_tfhd_atom()
@@ -3549,40 +5395,32 @@ static void dump_tfhd_atom()
 
     uint32_t track_id;
     MOV_CHECK(read_uint32(&track_id));
-    indent();
-    printf("track_id: %u\n", track_id);
+    out_field_uint("track_id", track_id);
 
     if (flags & 0x000001) {
         uint64_t base_data_offset;
         MOV_CHECK(read_uint64(&base_data_offset));
-        indent();
-        printf("base_data_offset: %" PRIu64 "\n", base_data_offset);
+        out_field_uint("base_data_offset", base_data_offset);
     }
     if (flags & 0x000002) {
         uint32_t sample_description_index;
         MOV_CHECK(read_uint32(&sample_description_index));
-        indent();
-        printf("sample_description_index: %u\n", sample_description_index);
+        out_field_uint("sample_description_index", sample_description_index);
     }
     if (flags & 0x000008) {
         uint32_t default_sample_duration;
         MOV_CHECK(read_uint32(&default_sample_duration));
-        indent();
-        printf("default_sample_duration: %u\n", default_sample_duration);
+        out_field_uint("default_sample_duration", default_sample_duration);
     }
     if (flags & 0x000010) {
         uint32_t default_sample_size;
         MOV_CHECK(read_uint32(&default_sample_size));
-        indent();
-        printf("default_sample_size: %u\n", default_sample_size);
+        out_field_uint("default_sample_size", default_sample_size);
     }
     if (flags & 0x000020) {
         uint32_t default_sample_flags;
         MOV_CHECK(read_uint32(&default_sample_flags));
-        indent();
-        printf("default_sample_flags: 0x%08x (", default_sample_flags);
-        dump_fragment_sample_flags(default_sample_flags);
-        printf(")\n");
+        out_field_sample_flags("default_sample_flags", "default_sample_flags_fields", default_sample_flags);
     }
 }
 
@@ -3599,80 +5437,86 @@ static void dump_trun_atom()
     if (flags & 0x000001) {
         int32_t data_offset;
         MOV_CHECK(read_int32(&data_offset));
-        indent();
-        printf("data_offset: %d\n", data_offset);
+        out_field_int("data_offset", data_offset);
     }
     if (flags & 0x000004) {
         uint32_t first_sample_flags;
         MOV_CHECK(read_uint32(&first_sample_flags));
-        indent();
-        printf("first_sample_flags: 0x%08x (", first_sample_flags);
-        dump_fragment_sample_flags(first_sample_flags);
-        printf(")\n");
+        out_field_sample_flags("first_sample_flags", "first_sample_flags_fields", first_sample_flags);
     }
 
     if (num_entries > 0) {
         indent();
-        printf("samples (");
+        out_printf("samples (");
+        out_key("num_samples");
         dump_uint32(num_entries, false);
-        printf("):\n");
+        out_printf("):\n");
 
         indent(4);
         if (num_entries < 0xffff)
-            printf("%4s", "i");
+            out_printf("%4s", "i");
         else if (num_entries < 0xffffff)
-            printf("%6s", "i");
+            out_printf("%6s", "i");
         else
-            printf("%8s", "i");
-        printf("%12s%12s%12s%12s\n",
+            out_printf("%8s", "i");
+        out_printf("%12s%12s%12s%12s\n",
                "duration", "size",  "flags", "ct_offset");
 
+        out_array_begin("samples", 4);
         uint32_t i;
         for (i = 0; i < num_entries; i++) {
+            out_object_begin(0, 4);
             indent(4);
             dump_uint32_index(num_entries, i);
 
             if (flags & 0x000100) {
                 uint32_t sample_duration;
                 MOV_CHECK(read_uint32(&sample_duration));
-                printf("%*c", 2, ' ');
+                out_printf("%*c", 2, ' ');
+                out_key("duration");
                 dump_uint32(sample_duration, true);
             } else {
-                printf("%12s", "x");
+                out_printf("%12s", "x");
             }
             if (flags & 0x000200) {
                 uint32_t sample_size;
                 MOV_CHECK(read_uint32(&sample_size));
-                printf("%*c", 2, ' ');
+                out_printf("%*c", 2, ' ');
+                out_key("size");
                 dump_uint32(sample_size, true);
             } else {
-                printf("%12s", "x");
+                out_printf("%12s", "x");
             }
             if (flags & 0x000400) {
                 uint32_t sample_flags;
                 MOV_CHECK(read_uint32(&sample_flags));
-                printf("%*c", 2, ' ');
+                out_printf("%*c", 2, ' ');
+                out_key("flags");
                 dump_uint32(sample_flags, true);
             } else {
-                printf("%12s", "x");
+                out_printf("%12s", "x");
             }
             if (flags & 0x000800) {
                 if (version == 0) {
                     uint32_t composition_time_offset;
                     MOV_CHECK(read_uint32(&composition_time_offset));
-                    printf("%*c", 2, ' ');
+                    out_printf("%*c", 2, ' ');
+                    out_key("ct_offset");
                     dump_uint32(composition_time_offset, false);
                 } else {
                     int32_t composition_time_offset;
                     MOV_CHECK(read_int32(&composition_time_offset));
-                    printf("%*c", 2, ' ');
+                    out_printf("%*c", 2, ' ');
+                    out_key("ct_offset");
                     dump_int32(composition_time_offset);
                 }
             } else {
-                printf("%12s", "x");
+                out_printf("%12s", "x");
             }
-            printf("\n");
+            out_printf("\n");
+            out_object_end();
         }
+        out_array_end();
     }
 }
 
@@ -3686,17 +5530,15 @@ static void dump_tfdt_atom()
     if (version == 0) {
         uint32_t base_media_decode_time;
         MOV_CHECK(read_uint32(&base_media_decode_time));
-        indent();
-        printf("base_media_decode_time: ");
+        out_field_begin("base_media_decode_time");
         dump_uint32(base_media_decode_time, true);
-        printf("\n");
+        out_field_end();
     } else {
         uint64_t base_media_decode_time;
         MOV_CHECK(read_uint64(&base_media_decode_time));
-        indent();
-        printf("base_media_decode_time: ");
+        out_field_begin("base_media_decode_time");
         dump_uint64(base_media_decode_time, true);
-        printf("\n");
+        out_field_end();
     }
 }
 
@@ -3733,48 +5575,61 @@ static void dump_ssix_atom()
     uint32_t sub_seg_count;
     MOV_CHECK(read_uint32(&sub_seg_count));
     indent();
-    printf("sub_segments (");
+    out_printf("sub_segments (");
+    out_key("num_sub_segments");
     dump_uint32(sub_seg_count, false);
-    printf("):\n");
+    out_printf("):\n");
 
+    out_array_begin("sub_segments", 4);
     uint32_t i;
     for (i = 0; i < sub_seg_count; i++) {
+        out_object_begin(0, 4);
         indent(4);
         dump_uint32_index(sub_seg_count, i);
 
         uint32_t ranges_count;
         MOV_CHECK(read_uint32(&ranges_count));
-        printf(": ranges (");
+        out_printf(": ranges (");
+        out_key("num_ranges");
         dump_uint32(ranges_count, false);
-        printf("):\n");
+        out_printf("):\n");
 
         indent(4);
         if (ranges_count < 0xffff)
-            printf("%4s", "i");
+            out_printf("%4s", "i");
         else if (ranges_count < 0xffffff)
-            printf("%6s", "i");
+            out_printf("%6s", "i");
         else
-            printf("%8s", "i");
-        printf("%8s%12s\n",
+            out_printf("%8s", "i");
+        out_printf("%8s%12s\n",
                "level", "range_size");
 
+        out_array_begin("ranges", 4);
         uint32_t j;
         for (j = 0; j < ranges_count; j++) {
+            out_object_begin(0, 4);
             indent(4);
             dump_uint32_index(ranges_count, j);
 
             uint8_t level;
             MOV_CHECK(read_uint8(&level));
-            printf("%*c", 4, ' ');
+            out_printf("%*c", 4, ' ');
+            out_key("level");
             dump_uint8(level, true);
 
             uint32_t range_size;
             MOV_CHECK(read_uint24(&range_size));
-            printf("%*c", 2, ' ');
+            out_printf("%*c", 2, ' ');
+            out_key("range_size");
             dump_uint32(range_size, true);
-            printf("\n");
+            out_printf("\n");
+            out_object_end();
         }
+        out_array_end();
+
+        out_object_end();
     }
+    out_array_end();
 }
 
 static void dump_top_atom()
@@ -3810,11 +5665,79 @@ static void dump_file()
     }
 }
 
+// Reads the remainder of the current atom into memory using a single read and uses it as the mapping
+static void load_atom_data()
+{
+    if (g_mov_map)
+        return;  // already mapped
+
+    if (CURRENT_ATOM.rem_size > SIZE_MAX)
+        throw MOVException("Atom size %" PRIu64 " is too large to load into memory", CURRENT_ATOM.rem_size);
+
+    size_t size = (size_t)CURRENT_ATOM.rem_size;
+    g_moov_buffer = (unsigned char*)malloc(size > 0 ? size : 1);
+    if (!g_moov_buffer)
+        throw MOVException("Failed to allocate buffer");
+    if (fread(g_moov_buffer, 1, size, g_mov_file) != size) {
+        if (ferror(g_mov_file))
+            throw MOVException("Failed to read bytes: %s", strerror(errno));
+        throw MOVException("Failed to read %" PRIu64 " bytes of '%.4s' atom data", CURRENT_ATOM.rem_size,
+                           CURRENT_ATOM.type);
+    }
+
+    g_mov_map = g_moov_buffer;
+    g_mov_map_offset = g_file_offset;
+    g_mov_map_size = size;
+}
+
+// Reads only the top-level atom headers until the 'moov' atom is found, loads the 'moov' atom into memory and
+// dumps it. The brand in the 'ftyp' atom is read but not dumped
+static void dump_moov_only()
+{
+    while (true) {
+        push_atom();
+
+        if (!read_atom_start())
+            throw MOVException("No 'moov' atom found");
+
+        if (equals_type(CURRENT_ATOM.type, "moov")) {
+            load_atom_data();
+            dump_top_atom();
+            pop_atom();
+            break;
+        }
+
+        if (equals_type(CURRENT_ATOM.type, "ftyp") && CURRENT_ATOM.rem_size >= 4) {
+            uint32_t major_brand;
+            MOV_CHECK(read_uint32(&major_brand));
+            g_qt_brand = (major_brand == MKTAG("qt  "));
+        }
+        skip_bytes(CURRENT_ATOM.rem_size);
+
+        pop_atom();
+    }
+}
+
 static void usage(const char *cmd)
 {
     fprintf(stderr, "Usage: %s [options] <quicktime filename>\n", cmd);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, " -h | --help       Print this usage message and exit\n");
+    fprintf(stderr, "  --no-mmap        Read the file using stdio rather than a read-only memory mapping\n");
+    fprintf(stderr, "  --moov-only      Only dump the 'moov' atom. The top-level atom headers are read to locate the 'moov'\n");
+    fprintf(stderr, "                   atom, which is then loaded using a single read. The file is not memory mapped\n");
+    fprintf(stderr, "  --json           Write the dump as JSON. Each atom is an object with type, size and offset, a 'fields'\n");
+    fprintf(stderr, "                   object holding the parsed values and a 'children' array holding the child atoms.\n");
+    fprintf(stderr, "                   Numbers are written as JSON numbers, types as strings and tables as arrays of\n");
+    fprintf(stderr, "                   objects, e.g. the 'stco' entries are {\"offset\": <offset>}\n");
+    fprintf(stderr, "  --full           Dump every entry in the 'stts', 'ctts', 'stsc', 'stsz', 'stco' and 'co64' sample tables.\n");
+    fprintf(stderr, "                   The default is to summarize the tables, e.g. the sample size statistics, the bitrate\n");
+    fprintf(stderr, "                   per second, the chunk offset monotonicity and the gaps between chunks\n");
+    fprintf(stderr, "  --select <path>  Only dump the atoms matching <path> and skip the atoms that can't contain a match.\n");
+    fprintf(stderr, "                   The option can be used multiple times. <path> is a '/' separated list of atom types\n");
+    fprintf(stderr, "                   starting at the top level, where '*' matches any type and the 'trak' type can be\n");
+    fprintf(stderr, "                   qualified by the handler type, e.g. 'trak[vide]'. Atoms in a sample description\n");
+    fprintf(stderr, "                   have the data format as the parent, e.g. 'moov/trak[vide]/mdia/minf/stbl/stsd/*/colr'\n");
     fprintf(stderr, "  --avcc <fname>   Write SPS and PPS NAL units in the 'avcC' box to <fname> file\n");
     fprintf(stderr, "                   The NAL units are prefixed by a length word with size defined in the 'avcC' box\n");
 }
@@ -3822,8 +5745,12 @@ static void usage(const char *cmd)
 int main(int argc, const char **argv)
 {
     const char *filename;
+    bool use_mmap = true;
+    bool moov_only = false;
     int cmdln_index;
 
+    be_decode_init();
+
     // parse commandline arguments
 
     for (cmdln_index = 1; cmdln_index < argc; cmdln_index++) {
@@ -3833,6 +5760,41 @@ int main(int argc, const char **argv)
             usage(argv[0]);
             return 0;
         }
+        else if (strcmp(argv[cmdln_index], "--no-mmap") == 0)
+        {
+            use_mmap = false;
+        }
+        else if (strcmp(argv[cmdln_index], "--moov-only") == 0)
+        {
+            moov_only = true;
+        }
+        else if (strcmp(argv[cmdln_index], "--json") == 0)
+        {
+            g_json_output = true;
+        }
+        else if (strcmp(argv[cmdln_index], "--full") == 0)
+        {
+            g_full_detail = true;
+        }
+        else if (strcmp(argv[cmdln_index], "--select") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            vector<SelectSegment> path;
+            if (!parse_select_path(argv[cmdln_index + 1], &path))
+            {
+                usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            g_select_paths.push_back(path);
+            g_out_suppressed = true;
+            cmdln_index++;
+        }
         else if (strcmp(argv[cmdln_index], "--avcc") == 0)
         {
             if (cmdln_index + 1 >= argc)
@@ -3876,24 +5838,59 @@ int main(int argc, const char **argv)
         return 1;
     }
 
+#if !defined(_WIN32)
+    // map the whole file so that values are decoded directly from the mapping and skipping is free. Fall back to
+    // stdio if the file can't be mapped, e.g. it is empty or not a regular file
+    if (use_mmap && !moov_only) {
+        struct stat file_stat;
+        if (fstat(fileno(g_mov_file), &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0 &&
+            (uint64_t)file_stat.st_size <= SIZE_MAX)
+        {
+            void *map = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(g_mov_file), 0);
+            if (map != MAP_FAILED) {
+                g_mov_map = (const unsigned char*)map;
+                g_mov_map_size = file_stat.st_size;
+            }
+        }
+    }
+#else
+    (void)use_mmap;
+#endif
+
 
     // dump file
 
+#if !defined(_WIN32)
+    g_out_line_buffered = isatty(STDOUT_FILENO);
+#endif
+    out_begin();
     try
     {
-        dump_file();
+        if (moov_only)
+            dump_moov_only();
+        else
+            dump_file();
     }
     catch (exception &ex)
     {
+        out_end();
         fprintf(stderr, "Exception: %s\n", ex.what());
         return 1;
     }
     catch (...)
     {
+        out_end();
         fprintf(stderr, "Unexpected exception\n");
         return 1;
     }
+    out_end();
 
+    if (g_moov_buffer)
+        free(g_moov_buffer);
+#if !defined(_WIN32)
+    else if (g_mov_map)
+        munmap((void*)g_mov_map, (size_t)g_mov_map_size);
+#endif
     if (g_mov_file)
         fclose(g_mov_file);
     if (g_avcc_file)
@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "movinfo.h"
+#include "bedecode.h"
+
+
+#define CHK(cmd)                                                                    \
+    do {                                                                            \
+        if (!(cmd)) {                                                               \
+            fprintf(stderr, "'%s' check failed at line %d\n", #cmd, __LINE__);      \
+            return 0;                                                               \
+        }                                                                           \
+    } while (0)
+
+#define MKTAG(cs) ((((uint32_t)cs[0])<<24)|(((uint32_t)cs[1])<<16)|(((uint32_t)cs[2])<<8)|(((uint32_t)cs[3])))
+
+#define MAX_MOOV_SIZE   (1024 * 1024 * 1024)
+
+#define DECODE_BLOCK_COUNT  1024
+
+// reserved, data reference index and the video sample description fields up to and including
+// the color table ID, which are followed by the extension atoms
+#define VIDEO_SAMPLE_ENTRY_SIZE     78
+
+
+typedef struct
+{
+    uint32_t type;
+    int64_t offset; // file offset of the atom's payload
+    const unsigned char *data;
+    uint64_t size;
+    uint64_t hash;
+} MOVAtom;
+
+typedef struct
+{
+    MOVAtom stsc;
+    MOVAtom stsz;
+    MOVAtom stco;
+    MOVAtom stss;
+    int is_co64;
+} SampleTable;
+
+
+
+static uint32_t get_uint32(const unsigned char *bytes)
+{
+    return (((uint32_t)bytes[0]) << 24) |
+           (((uint32_t)bytes[1]) << 16) |
+           (((uint32_t)bytes[2]) << 8) |
+             (uint32_t)bytes[3];
+}
+
+static uint64_t get_uint64(const unsigned char *bytes)
+{
+    return (((uint64_t)get_uint32(bytes)) << 32) | get_uint32(&bytes[4]);
+}
+
+static int64_t get_file_size(FILE *file)
+{
+    int64_t file_size;
+
+    if (fseeko(file, 0, SEEK_END) < 0)
+        return -1;
+    file_size = ftello(file);
+
+    return file_size;
+}
+
+static int read_top_atom_header(FILE *file, int64_t offset, int64_t file_size, uint32_t *type, uint64_t *size,
+                                uint32_t *header_size)
+{
+    unsigned char bytes[16];
+
+    if (offset + 8 > file_size || fseeko(file, offset, SEEK_SET) < 0 || fread(bytes, 1, 8, file) != 8)
+        return 0;
+
+    *type = get_uint32(&bytes[4]);
+    *size = get_uint32(bytes);
+    *header_size = 8;
+    if (*size == 1) {
+        CHK(fread(&bytes[8], 1, 8, file) == 8);
+        *size = get_uint64(&bytes[8]);
+        *header_size = 16;
+    } else if (*size == 0) {
+        // atom extends to the end of the file
+        *size = file_size - offset;
+    }
+    CHK(*size >= *header_size);
+
+    return 1;
+}
+
+static int next_child_atom(const MOVAtom *parent, uint64_t *pos, MOVAtom *child)
+{
+    const unsigned char *bytes = &parent->data[*pos];
+    uint64_t rem_size = parent->size - *pos;
+    uint64_t header_size = 8;
+    uint64_t size;
+
+    if (rem_size < 8)
+        return 0;
+
+    size = get_uint32(bytes);
+    if (size == 1) {
+        CHK(rem_size >= 16);
+        size = get_uint64(&bytes[8]);
+        header_size = 16;
+    } else if (size == 0) {
+        size = rem_size;
+    }
+    CHK(size >= header_size && size <= rem_size);
+
+    child->type   = get_uint32(&bytes[4]);
+    child->offset = parent->offset + *pos + header_size;
+    child->data   = bytes + header_size;
+    child->size   = size - header_size;
+    *pos += size;
+
+    return 1;
+}
+
+static int find_child_atom(const MOVAtom *parent, uint32_t type, MOVAtom *child)
+{
+    uint64_t pos = 0;
+
+    while (next_child_atom(parent, &pos, child)) {
+        if (child->type == type)
+            return 1;
+    }
+
+    return 0;
+}
+
+static int is_video_track(const MOVAtom *trak)
+{
+    MOVAtom mdia, hdlr;
+
+    // hdlr: version + flags, component type, component sub-type
+    return find_child_atom(trak, MKTAG("mdia"), &mdia) &&
+           find_child_atom(&mdia, MKTAG("hdlr"), &hdlr) &&
+           hdlr.size >= 12 &&
+           get_uint32(&hdlr.data[8]) == MKTAG("vide");
+}
+
+static int read_sample_table(const MOVAtom *trak, SampleTable *sample_table)
+{
+    MOVAtom mdia, minf, stbl;
+
+    CHK(find_child_atom(trak, MKTAG("mdia"), &mdia));
+    CHK(find_child_atom(&mdia, MKTAG("minf"), &minf));
+    CHK(find_child_atom(&minf, MKTAG("stbl"), &stbl));
+
+    if (!find_child_atom(&stbl, MKTAG("stsc"), &sample_table->stsc) ||
+        !find_child_atom(&stbl, MKTAG("stsz"), &sample_table->stsz))
+    {
+        fprintf(stderr, "Video track sample table is missing a 'stsc' or 'stsz' atom\n");
+        return 0;
+    }
+    if (!find_child_atom(&stbl, MKTAG("stss"), &sample_table->stss))
+        memset(&sample_table->stss, 0, sizeof(sample_table->stss));
+    if (find_child_atom(&stbl, MKTAG("co64"), &sample_table->stco)) {
+        sample_table->is_co64 = 1;
+    } else if (find_child_atom(&stbl, MKTAG("stco"), &sample_table->stco)) {
+        sample_table->is_co64 = 0;
+    } else {
+        fprintf(stderr, "Video track sample table is missing a 'stco' or 'co64' atom\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+static int find_video_sample_entry(const MOVAtom *trak, MOVAtom *entry)
+{
+    MOVAtom mdia, minf, stbl, stsd, entries;
+    uint64_t pos = 0;
+
+    if (!find_child_atom(trak, MKTAG("mdia"), &mdia) ||
+        !find_child_atom(&mdia, MKTAG("minf"), &minf) ||
+        !find_child_atom(&minf, MKTAG("stbl"), &stbl) ||
+        !find_child_atom(&stbl, MKTAG("stsd"), &stsd) ||
+        stsd.size < 8)
+    {
+        return 0;
+    }
+
+    // stsd: version + flags, number of entries, sample description entries
+    entries = stsd;
+    entries.offset += 8;
+    entries.data   += 8;
+    entries.size   -= 8;
+
+    return next_child_atom(&entries, &pos, entry) &&
+           entry->size >= VIDEO_SAMPLE_ENTRY_SIZE;
+}
+
+static void read_video_sample_entry(const MOVAtom *trak, MOVInfo *info)
+{
+    MOVAtom entry, colr, fiel;
+    uint32_t color_param_type;
+
+    if (!find_video_sample_entry(trak, &entry))
+        return;
+
+    // the width and height follow the reserved, data reference index, version, revision level, vendor and
+    // temporal and spatial quality fields
+    info->have_sample_entry = 1;
+    info->width  = (uint16_t)((entry.data[24] << 8) | entry.data[25]);
+    info->height = (uint16_t)((entry.data[26] << 8) | entry.data[27]);
+
+    entry.offset += VIDEO_SAMPLE_ENTRY_SIZE;
+    entry.data   += VIDEO_SAMPLE_ENTRY_SIZE;
+    entry.size   -= VIDEO_SAMPLE_ENTRY_SIZE;
+
+    if (find_child_atom(&entry, MKTAG("fiel"), &fiel) && fiel.size >= 2) {
+        info->have_fiel   = 1;
+        info->fiel_fields = fiel.data[0];
+        info->fiel_detail = fiel.data[1];
+    }
+
+    if (!find_child_atom(&entry, MKTAG("colr"), &colr) || colr.size < 10)
+        return;
+
+    // 'nclx' adds a full range flag after the 'nclc' values
+    color_param_type = get_uint32(colr.data);
+    if (color_param_type != MKTAG("nclc") && color_param_type != MKTAG("nclx"))
+        return;
+
+    info->have_colr   = 1;
+    info->colr_offset = colr.offset + 4;
+    info->colr[0]     = (uint16_t)((colr.data[4] << 8) | colr.data[5]);
+    info->colr[1]     = (uint16_t)((colr.data[6] << 8) | colr.data[7]);
+    info->colr[2]     = (uint16_t)((colr.data[8] << 8) | colr.data[9]);
+}
+
+// Decodes a big-endian table in blocks of native values that stay in the cache
+typedef struct
+{
+    const unsigned char *data;
+    uint32_t value_size;    // 4 or 8
+    size_t count;
+    size_t next;            // index of the first value that has not been decoded
+    uint64_t block64[DECODE_BLOCK_COUNT];
+    uint32_t block32[DECODE_BLOCK_COUNT];
+    size_t block_pos;
+    size_t block_count;
+} TableDecoder;
+
+
+static void init_table_decoder(TableDecoder *decoder, const unsigned char *data, uint32_t value_size, size_t count)
+{
+    decoder->data        = data;
+    decoder->value_size  = value_size;
+    decoder->count       = count;
+    decoder->next        = 0;
+    decoder->block_pos   = 0;
+    decoder->block_count = 0;
+}
+
+// The caller ensures that there is a next value
+static uint64_t next_table_value(TableDecoder *decoder)
+{
+    if (decoder->block_pos >= decoder->block_count) {
+        size_t block_count = decoder->count - decoder->next;
+        if (block_count > DECODE_BLOCK_COUNT)
+            block_count = DECODE_BLOCK_COUNT;
+        if (decoder->value_size == 8)
+            be_decode_uint64(decoder->block64, &decoder->data[decoder->next * 8], block_count);
+        else
+            be_decode_uint32(decoder->block32, &decoder->data[decoder->next * 4], block_count);
+        decoder->next        += block_count;
+        decoder->block_pos   = 0;
+        decoder->block_count = block_count;
+    }
+
+    if (decoder->value_size == 8)
+        return decoder->block64[decoder->block_pos++];
+    else
+        return decoder->block32[decoder->block_pos++];
+}
+
+static int resolve_frame_index(const SampleTable *sample_table, FrameIndex *index)
+{
+    const unsigned char *stsc = sample_table->stsc.data;
+    const unsigned char *stsz = sample_table->stsz.data;
+    const unsigned char *stco = sample_table->stco.data;
+    uint32_t chunk_offset_size = (sample_table->is_co64 ? 8 : 4);
+    uint32_t num_stsc_entries;
+    uint32_t fixed_sample_size;
+    uint32_t num_samples;
+    uint32_t num_chunks;
+    uint32_t stsc_index = 0;
+    uint32_t sample_num = 0;
+    uint32_t chunk;
+    TableDecoder *decoders;
+    TableDecoder *stsz_decoder;
+    TableDecoder *stco_decoder;
+
+    // each table starts with a version and flags field
+    CHK(sample_table->stsc.size >= 8);
+    num_stsc_entries = get_uint32(&stsc[4]);
+    CHK((sample_table->stsc.size - 8) / 12 >= num_stsc_entries);
+
+    CHK(sample_table->stsz.size >= 12);
+    fixed_sample_size = get_uint32(&stsz[4]);
+    num_samples = get_uint32(&stsz[8]);
+    CHK(fixed_sample_size != 0 || (sample_table->stsz.size - 12) / 4 >= num_samples);
+
+    CHK(sample_table->stco.size >= 8);
+    num_chunks = get_uint32(&stco[4]);
+    CHK((sample_table->stco.size - 8) / chunk_offset_size >= num_chunks);
+    CHK(num_chunks == 0 || num_stsc_entries > 0);
+
+    CHK(frame_index_reserve(index, index->count + num_samples));
+
+    // the sample sizes and chunk offsets are decoded in bulk, a block at a time
+    CHK((decoders = malloc(2 * sizeof(TableDecoder))));
+    stsz_decoder = &decoders[0];
+    stco_decoder = &decoders[1];
+    init_table_decoder(stsz_decoder, &stsz[12], 4, (fixed_sample_size ? 0 : num_samples));
+    init_table_decoder(stco_decoder, &stco[8], chunk_offset_size, num_chunks);
+
+    for (chunk = 0; chunk < num_chunks && sample_num < num_samples; chunk++) {
+        uint32_t samples_per_chunk;
+        int64_t offset;
+        uint32_t i;
+
+        // stsc first_chunk values are 1-based
+        while (stsc_index + 1 < num_stsc_entries && get_uint32(&stsc[8 + (stsc_index + 1) * 12]) <= chunk + 1)
+            stsc_index++;
+        samples_per_chunk = get_uint32(&stsc[8 + stsc_index * 12 + 4]);
+
+        offset = (int64_t)next_table_value(stco_decoder);
+        for (i = 0; i < samples_per_chunk && sample_num < num_samples; i++) {
+            uint32_t size = (fixed_sample_size ? fixed_sample_size : (uint32_t)next_table_value(stsz_decoder));
+            if (!frame_index_append(index, offset, size)) {
+                free(decoders);
+                return 0;
+            }
+            offset += size;
+            sample_num++;
+        }
+    }
+    free(decoders);
+    if (sample_num < num_samples) {
+        fprintf(stderr, "Sample table chunks only contain %u of %u samples\n", sample_num, num_samples);
+        return 0;
+    }
+
+    // all samples are sync samples if there is no 'stss' atom
+    if (sample_table->stss.data) {
+        const unsigned char *stss = sample_table->stss.data;
+        uint32_t num_sync_samples;
+        uint32_t i;
+
+        CHK(sample_table->stss.size >= 8);
+        num_sync_samples = get_uint32(&stss[4]);
+        CHK((sample_table->stss.size - 8) / 4 >= num_sync_samples);
+
+        for (i = 0; i < index->count; i++)
+            index->entries[i].keyframe = 0;
+        for (i = 0; i < num_sync_samples; i++) {
+            // sample numbers are 1-based
+            uint32_t sample = get_uint32(&stss[8 + i * 4]);
+            if (sample >= 1 && sample <= index->count)
+                index->entries[sample - 1].keyframe = 1;
+        }
+    }
+
+    return 1;
+}
+
+static int read_moov(FILE *file, MOVAtom *moov, unsigned char **buffer)
+{
+    int64_t file_size = get_file_size(file);
+    int64_t offset = 0;
+    uint32_t type;
+    uint64_t size;
+    uint32_t header_size;
+
+    CHK(file_size >= 0);
+
+    while (read_top_atom_header(file, offset, file_size, &type, &size, &header_size)) {
+        if (type == MKTAG("moov")) {
+            CHK(size - header_size <= MAX_MOOV_SIZE);
+            *buffer = (unsigned char*)malloc(size - header_size);
+            CHK(*buffer);
+            if (fread(*buffer, 1, size - header_size, file) != size - header_size) {
+                fprintf(stderr, "Failed to read 'moov' atom: %s\n", (ferror(file) ? strerror(errno) : "end of file"));
+                free(*buffer);
+                *buffer = NULL;
+                return 0;
+            }
+
+            moov->hash   = frame_index_hash(*buffer, size - header_size);
+            moov->type   = type;
+            moov->offset = offset + header_size;
+            moov->data   = *buffer;
+            moov->size   = size - header_size;
+            return 1;
+        }
+
+        offset += size;
+    }
+
+    fprintf(stderr, "Failed to find a 'moov' atom\n");
+    return 0;
+}
+
+void mov_info_init(MOVInfo *info)
+{
+    memset(info, 0, sizeof(*info));
+    frame_index_init(&info->frame_index);
+}
+
+void mov_info_clear(MOVInfo *info)
+{
+    frame_index_clear(&info->frame_index);
+}
+
+static int find_video_track(const MOVAtom *moov, MOVAtom *trak)
+{
+    uint64_t pos = 0;
+
+    while (next_child_atom(moov, &pos, trak)) {
+        if (trak->type == MKTAG("trak") && is_video_track(trak))
+            return 1;
+    }
+
+    fprintf(stderr, "Failed to find a video track\n");
+    return 0;
+}
+
+int mov_read_info(FILE *file, MOVInfo *info)
+{
+    unsigned char *buffer = NULL;
+    MOVAtom moov, trak;
+    SampleTable sample_table;
+    int result;
+
+    memset(&sample_table, 0, sizeof(sample_table));
+
+    result = read_moov(file, &moov, &buffer) &&
+             find_video_track(&moov, &trak) &&
+             read_sample_table(&trak, &sample_table) &&
+             resolve_frame_index(&sample_table, &info->frame_index);
+    if (result) {
+        info->moov_hash = moov.hash;
+        read_video_sample_entry(&trak, info);
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+int mov_get_frame_index_source(FILE *file, FrameIndexSource *source)
+{
+    unsigned char *buffer = NULL;
+    unsigned char bytes[8];
+    MOVAtom moov;
+
+    CHK(frame_index_get_source(fileno(file), source));
+
+    // raw bitstreams start with a frame_size and the 'icpf' frame_identifier
+    CHK(fseeko(file, 0, SEEK_SET) == 0);
+    if (fread(bytes, 1, 8, file) == 8 && get_uint32(&bytes[4]) == MKTAG("icpf"))
+        return 1;
+
+    if (!read_moov(file, &moov, &buffer))
+        return 0;
+    source->moov_hash = moov.hash;
+    free(buffer);
+
+    return 1;
+}
+
+int mov_read_frame_index_file(FILE *file, FrameIndex *index, const char *filename)
+{
+    FrameIndexSource index_source, file_source;
+
+    if (!frame_index_read_file(index, &index_source, filename))
+        return 0;
+
+    CHK(frame_index_get_source(fileno(file), &file_source));
+    if (frame_index_source_matches(&index_source, &file_source, 1))
+        return 1;
+
+    // the modification time changes if the file is copied or modified in place, in which case the
+    // index is still valid if the 'moov' atom hasn't changed
+    if (index_source.moov_hash != 0 &&
+        mov_get_frame_index_source(file, &file_source) &&
+        frame_index_source_matches(&index_source, &file_source, 0))
+    {
+        return 1;
+    }
+
+    fprintf(stderr, "Frame index file '%s' was not created for this file\n", filename);
+    return 0;
+}
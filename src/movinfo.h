@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017, British Broadcasting Corporation
+ * All Rights Reserved.
+ *
+ * Author: Philip de Nier
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the British Broadcasting Corporation nor the names
+ *       of its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOVINFO_H_
+#define MOVINFO_H_
+
+#include <stdio.h>
+
+#include "frameindex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct
+{
+    FrameIndex frame_index;
+    uint64_t moov_hash;
+
+    // 'colr' atom in the first video sample description
+    int have_colr;
+    int64_t colr_offset;    // file offset of the 16-bit primaries, transfer function and matrix values
+    uint16_t colr[3];
+
+    // dimensions in the first video sample description and its 'fiel' atom
+    int have_sample_entry;
+    uint16_t width;
+    uint16_t height;
+    int have_fiel;
+    uint8_t fiel_fields;    // 1: progressive, 2: interlaced
+    uint8_t fiel_detail;
+} MOVInfo;
+
+
+void mov_info_init(MOVInfo *info);
+void mov_info_clear(MOVInfo *info);
+
+// Reads the 'moov' atom and resolves the file offset and size of each sample in the first video
+// track using the sample table atoms ('stsc', 'stsz' and 'stco' or 'co64'). The dimensions, the 'colr'
+// atom values and location and the 'fiel' atom values are also read from the video sample description
+int mov_read_info(FILE *file, MOVInfo *info);
+
+// Loads a frame index file and checks that it was created for the file. The file matches if the size and
+// modification time are the same or, if the modification time differs, the 'moov' atom is the same
+int mov_read_frame_index_file(FILE *file, FrameIndex *index, const char *filename);
+// Sets the identity of the file, including the 'moov' atom hash if it is a Quicktime file
+int mov_get_frame_index_source(FILE *file, FrameIndexSource *source);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -38,16 +38,32 @@
 #include <assert.h>
 #include <ctype.h>
 #include <limits.h>
+#include <pthread.h>
 
+#include "movinfo.h"
+#include "bedecode.h"
 
-#define PRINT_UINT(name)        printf("%*c " name ": %"      PRIu64 "\n", context->indent * 4, ' ', context->value)
-#define PRINT_UINT8_HEX(name)   printf("%*c " name ": 0x%02"  PRIx64 "\n", context->indent * 4, ' ', context->value)
+
+#define PRINT_UINT(name)        fprintf(context->out, "%*c " name ": %"      PRIu64 "\n", context->indent * 4, ' ', context->value)
+#define PRINT_UINT8_HEX(name)   fprintf(context->out, "%*c " name ": 0x%02"  PRIx64 "\n", context->indent * 4, ' ', context->value)
 
 #define PRINT_ENUM(name, strings, default_string) \
     print_enum(context, name, strings, ARRAY_SIZE(strings), default_string)
 
 #define ARRAY_SIZE(array)       (sizeof(array) / sizeof((array)[0]))
 
+#define READ_BUFFER_SIZE        16384
+#define HEADER_READ_SIZE        256
+
+#define MAX_THREADS             256
+#define CHUNK_FRAME_COUNT       64
+#define MAX_PENDING_CHUNKS      4   // per thread
+
+#define RDD36_FRAME_ID          0x69637066  // 'icpf'
+
+#define SIGNATURE_TABLE_SIZE    128
+#define MAX_SIGNATURES          64  // the table is at most half full
+
 #define CHK(cmd)                                                                    \
     do {                                                                            \
         if (!(cmd)) {                                                               \
@@ -57,22 +73,81 @@
     } while (0)
 
 
+// The frame_header fields that are expected to be the same in every frame of a file
+typedef struct
+{
+    uint32_t encoder_identifier;
+    uint16_t horizontal_size;
+    uint16_t vertical_size;
+    uint8_t bitstream_version;
+    uint8_t chroma_format;
+    uint8_t interlace_mode;
+    uint8_t aspect_ratio_information;
+    uint8_t frame_rate_code;
+    uint8_t color_primaries;
+    uint8_t transfer_characteristic;
+    uint8_t matrix_coefficients;
+    uint8_t alpha_channel_type;
+    uint8_t load_luma_quantization_matrix;
+    uint8_t load_chroma_quantization_matrix;
+    uint8_t luma_quantization_matrix[64];
+    uint8_t chroma_quantization_matrix[64];
+} HeaderSignature;
+
+typedef struct
+{
+    HeaderSignature signature;
+    uint64_t hash;
+    int64_t count;
+    int64_t first_frame;
+    int64_t last_frame;
+    int used;
+} SignatureEntry;
+
+// Fixed size open addressing hash table. Frames with a new signature are only counted once the table has
+// MAX_SIGNATURES signatures
+typedef struct
+{
+    SignatureEntry entries[SIGNATURE_TABLE_SIZE];
+    size_t num_signatures;
+    int64_t num_frames;
+    int64_t other_count;
+} SignatureTable;
+
 typedef struct
 {
     FILE *file;
-    int64_t next_read_pos;
     int eof;
+    int io_error;
+    size_t read_size;
+
+    uint8_t buffer[READ_BUFFER_SIZE];
+    int64_t buffer_file_pos;
+    size_t buffer_size;
+    size_t buffer_pos;
 
-    uint8_t current_byte;
-    int next_bit;
+    uint64_t cache;
+    int cache_bits;
     uint64_t value;
 
+    FILE *out;
     int indent;
     int64_t frame_count;
+    int header_only;
 
+    int64_t slice_threshold;
+    SignatureTable *signatures;
+    const MOVInfo *check_info;
+    uint32_t sample_size;
+    int64_t check_frame_count;
+    int64_t disagreement_count;
+
+    uint16_t horizontal_size;
+    uint16_t vertical_size;
     uint8_t interlace_mode;
     uint8_t picture_header_size;
     uint32_t picture_size;
+    uint8_t log2_desired_slice_size_in_mb;
 } ParseContext;
 
 
@@ -179,81 +254,144 @@ static const char *ALPHA_CHANNEL_TYPE_STRINGS[] =
 
 
 
-static int read_next_byte(ParseContext *context)
+static uint64_t get_uint64(const uint8_t *bytes)
 {
-    int c;
+    return (((uint64_t)bytes[0]) << 56) |
+           (((uint64_t)bytes[1]) << 48) |
+           (((uint64_t)bytes[2]) << 40) |
+           (((uint64_t)bytes[3]) << 32) |
+           (((uint64_t)bytes[4]) << 24) |
+           (((uint64_t)bytes[5]) << 16) |
+           (((uint64_t)bytes[6]) << 8) |
+             (uint64_t)bytes[7];
+}
 
-    c = fgetc(context->file);
-    if (c == EOF) {
+static int fill_buffer(ParseContext *context)
+{
+    context->buffer_file_pos += context->buffer_size;
+    context->buffer_pos = 0;
+    context->buffer_size = fread(context->buffer, 1, context->read_size, context->file);
+    if (context->buffer_size == 0) {
         if (feof(context->file)) {
             context->eof = 1;
         } else {
             fprintf(stderr, "File I/O error: %s\n", strerror(errno));
+            context->io_error = 1;
         }
         return 0;
     }
 
-    context->next_read_pos++;
-    context->next_bit = 7;
-    context->current_byte = (uint8_t)c;
-
     return 1;
 }
 
+// Tops up the bit cache to at least 57 bits if the data is available. The unused low bits of
+// the cache are kept zero
+static void fill_cache(ParseContext *context)
+{
+    while (context->cache_bits <= 56) {
+        size_t rem_size = context->buffer_size - context->buffer_pos;
+
+        if (rem_size >= 8) {
+            // load a big-endian word and keep the whole bytes that fit in the cache
+            int num_bytes = (64 - context->cache_bits) >> 3;
+            int new_cache_bits = context->cache_bits + num_bytes * 8;
+            uint64_t word = get_uint64(&context->buffer[context->buffer_pos]) >> context->cache_bits;
+
+            if (new_cache_bits < 64)
+                word &= ~(UINT64_MAX >> new_cache_bits);
+            context->cache |= word;
+            context->cache_bits = new_cache_bits;
+            context->buffer_pos += num_bytes;
+        } else if (rem_size > 0) {
+            context->cache |= ((uint64_t)context->buffer[context->buffer_pos]) << (56 - context->cache_bits);
+            context->cache_bits += 8;
+            context->buffer_pos++;
+        } else if (!fill_buffer(context)) {
+            break;
+        }
+    }
+}
+
+static int64_t get_bit_pos(ParseContext *context)
+{
+    return (context->buffer_file_pos + (int64_t)context->buffer_pos) * 8 - context->cache_bits;
+}
+
 static int64_t get_file_pos(ParseContext *context)
 {
-    return context->next_read_pos - (context->next_bit >= 0 ? 1 : 0);
+    return get_bit_pos(context) / 8;
 }
 
 static int seek_to_offset(ParseContext *context, int64_t offset)
 {
+    context->cache = 0;
+    context->cache_bits = 0;
+
+    // seeks within the buffer don't require a file seek
+    if (offset >= context->buffer_file_pos && offset < context->buffer_file_pos + (int64_t)context->buffer_size) {
+        context->buffer_pos = (size_t)(offset - context->buffer_file_pos);
+        return 1;
+    }
+
     if (fseeko(context->file, offset, SEEK_SET) < 0)
         return 0;
 
-    context->next_bit = -1;
-    context->next_read_pos = offset;
+    context->buffer_file_pos = offset;
+    context->buffer_size = 0;
+    context->buffer_pos = 0;
 
     return 1;
 }
 
 static int have_byte(ParseContext *context)
 {
-    return context->next_bit >= 0 || read_next_byte(context);
+    return context->cache_bits > 0 || context->buffer_pos < context->buffer_size || fill_buffer(context);
 }
 
 static int skip_bytes_align(ParseContext *context, int64_t count)
 {
-    int64_t offset = count;
+    int64_t offset = get_file_pos(context) + count;
+    int64_t aligned_offset = (get_bit_pos(context) + 7) / 8;
 
-    if (context->next_bit >= 0)
-        offset--;
+    if (offset < aligned_offset)
+        offset = aligned_offset;
 
-    if (offset <= 0) {
-        offset = 0;
-    } else if (fseeko(context->file, offset, SEEK_CUR) < 0) {
+    if (!seek_to_offset(context, offset)) {
         fprintf(stderr, "Seek error: %s\n", strerror(errno));
         return 0;
     }
 
-    context->next_bit = -1;
-    context->next_read_pos += offset;
-
     return 1;
 }
 
 static int read_bits(ParseContext *context, int n)
 {
-    int i;
+    uint64_t high_bits;
 
     assert(n <= 64);
 
-    context->value = 0;
-    for (i = 0; i < n; i++) {
-        if (context->next_bit < 0 && !read_next_byte(context))
+    if (n > 32) {
+        if (!read_bits(context, n - 32))
+            return 0;
+        high_bits = context->value;
+        if (!read_bits(context, 32))
             return 0;
-        context->value <<= 1;
-        context->value |= (context->current_byte >> context->next_bit) & 0x1;
-        context->next_bit--;
+        context->value |= high_bits << 32;
+        return 1;
+    }
+
+    if (context->cache_bits < n) {
+        fill_cache(context);
+        if (context->cache_bits < n)
+            return 0;
+    }
+
+    if (n == 0) {
+        context->value = 0;
+    } else {
+        context->value = context->cache >> (64 - n);
+        context->cache <<= n;
+        context->cache_bits -= n;
     }
 
     return 1;
@@ -275,7 +413,7 @@ static void print_structure_start(ParseContext *context, const char *name)
 {
     int64_t file_pos = get_file_pos(context);
 
-    printf("%*c %s: pos=%" PRId64 "\n", context->indent * 4, ' ', name, file_pos);
+    fprintf(context->out, "%*c %s: pos=%" PRId64 "\n", context->indent * 4, ' ', name, file_pos);
 }
 
 static void print_fourcc(ParseContext *context, const char *name)
@@ -283,16 +421,16 @@ static void print_fourcc(ParseContext *context, const char *name)
     int i;
     uint32_t value = (uint32_t)context->value;
 
-    printf("%*c %s: 0x%08x (", context->indent * 4, ' ', name, value);
+    fprintf(context->out, "%*c %s: 0x%08x (", context->indent * 4, ' ', name, value);
 
     for (i = 0; i < 4; i++) {
         char c = (char)(value >> (8 * (3 - i)));
         if (isprint(c))
-            printf("%c", c);
+            fprintf(context->out, "%c", c);
         else
-            printf(".");
+            fprintf(context->out, ".");
     }
-    printf(")\n");
+    fprintf(context->out, ")\n");
 }
 
 static void print_enum(ParseContext *context, const char *name, const char **strings, size_t strings_size,
@@ -300,28 +438,28 @@ static void print_enum(ParseContext *context, const char *name, const char **str
 {
     uint8_t value = (uint8_t)context->value;
 
-    printf("%*c %s: %" PRIu64 , context->indent * 4, ' ', name, context->value);
+    fprintf(context->out, "%*c %s: %" PRIu64 , context->indent * 4, ' ', name, context->value);
 
     if (value < strings_size)
-        printf(" (%s)\n", strings[value]);
+        fprintf(context->out, " (%s)\n", strings[value]);
     else
-        printf(" (%s)\n", default_string);
+        fprintf(context->out, " (%s)\n", default_string);
 }
 
 static int dump_quantization_matrix(ParseContext *context, const char *name)
 {
     int u, v;
 
-    printf("%*c %s:\n", context->indent * 4, ' ', name);
+    fprintf(context->out, "%*c %s:\n", context->indent * 4, ' ', name);
 
     context->indent++;
 
     for (v = 0; v < 8; v++) {
-        printf("%*c ", context->indent * 4, ' ');
+        fprintf(context->out, "%*c ", context->indent * 4, ' ');
         for (u = 0; u < 8; u++) {
-            u(8); printf(" %02x", (uint8_t)context->value);
+            u(8); fprintf(context->out, " %02x", (uint8_t)context->value);
         }
-        printf("\n");
+        fprintf(context->out, "\n");
     }
 
     context->indent--;
@@ -336,7 +474,7 @@ static int stuffing(ParseContext *context, int64_t size)
     context->indent++;
 
     // TODO: report remainder bits?
-    printf("%*c size: %" PRIi64 "\n", context->indent * 4, ' ', size);
+    fprintf(context->out, "%*c size: %" PRIi64 "\n", context->indent * 4, ' ', size);
     CHK(skip_bytes_align(context, size));
 
     context->indent--;
@@ -356,6 +494,7 @@ static int picture_header(ParseContext *context)
     u(16); PRINT_UINT("deprecated_number_of_slices");
     u(2);  PRINT_UINT8_HEX("reserved");
     u(2);  PRINT_UINT("log2_desired_slice_size_in_mb");
+    context->log2_desired_slice_size_in_mb = (uint8_t)context->value;
     u(4);  PRINT_UINT8_HEX("reserved");
 
     CHK(context->picture_size >= context->picture_header_size);
@@ -367,15 +506,105 @@ static int picture_header(ParseContext *context)
     return 1;
 }
 
+// Returns the number of slices in the picture, which follows from the frame dimensions and slice size
+static uint32_t get_number_of_slices(ParseContext *context, int temporal_order)
+{
+    uint32_t width_in_mb = (context->horizontal_size + 15) / 16;
+    uint32_t slice_size_in_mb = 1 << context->log2_desired_slice_size_in_mb;
+    uint32_t number_of_slices_per_mb_row;
+    uint32_t picture_vertical_size;
+    uint32_t height_in_mb;
+    uint32_t rem_width_in_mb;
+
+    // the top field has the extra line if the vertical_size is odd and it is the first picture in a TFF frame
+    if (context->interlace_mode == 1)
+        picture_vertical_size = (temporal_order == 1 ? context->vertical_size + 1 : context->vertical_size) / 2;
+    else if (context->interlace_mode == 2)
+        picture_vertical_size = (temporal_order == 2 ? context->vertical_size + 1 : context->vertical_size) / 2;
+    else
+        picture_vertical_size = context->vertical_size;
+    height_in_mb = (picture_vertical_size + 15) / 16;
+
+    // each mb row is covered by slices of slice_size_in_mb followed by slices with decreasing power of 2 sizes
+    number_of_slices_per_mb_row = width_in_mb >> context->log2_desired_slice_size_in_mb;
+    for (rem_width_in_mb = width_in_mb & (slice_size_in_mb - 1); rem_width_in_mb; rem_width_in_mb &= rem_width_in_mb - 1)
+        number_of_slices_per_mb_row++;
+
+    return number_of_slices_per_mb_row * height_in_mb;
+}
+
+// Reads the coded_size_of_slice entries and prints the slice size statistics. The slice data is skipped
+static int slice_table(ParseContext *context, int temporal_order, uint32_t *slice_data_size)
+{
+    uint32_t number_of_slices = get_number_of_slices(context, temporal_order);
+    uint32_t min_size = 0;
+    uint32_t max_size = 0;
+    uint64_t sum = 0;
+    uint64_t sum_squares = 0;
+    uint32_t over_threshold = 0;
+    double mean = 0.0;
+    double variance = 0.0;
+    uint32_t i;
+
+    print_structure_start(context, "slice_table");
+
+    context->indent++;
+
+    fprintf(context->out, "%*c number_of_slices: %u\n", context->indent * 4, ' ', number_of_slices);
+    CHK((uint64_t)number_of_slices * 2 <= context->picture_size - context->picture_header_size);
+
+    for (i = 0; i < number_of_slices; i++) {
+        uint32_t size;
+        u(16);
+        size = (uint32_t)context->value;
+        if (i == 0 || size < min_size)
+            min_size = size;
+        if (size > max_size)
+            max_size = size;
+        sum += size;
+        sum_squares += (uint64_t)size * size;
+        if (context->slice_threshold >= 0 && size > context->slice_threshold)
+            over_threshold++;
+    }
+    if (number_of_slices > 0) {
+        mean = (double)sum / number_of_slices;
+        variance = (double)sum_squares / number_of_slices - mean * mean;
+        if (variance < 0.0)
+            variance = 0.0;
+    }
+
+    fprintf(context->out, "%*c min_slice_size: %u\n", context->indent * 4, ' ', min_size);
+    fprintf(context->out, "%*c max_slice_size: %u\n", context->indent * 4, ' ', max_size);
+    fprintf(context->out, "%*c mean_slice_size: %.2f\n", context->indent * 4, ' ', mean);
+    fprintf(context->out, "%*c slice_size_variance: %.2f\n", context->indent * 4, ' ', variance);
+    if (context->slice_threshold >= 0) {
+        fprintf(context->out, "%*c slices_over_threshold: %u (> %" PRId64 " bytes)\n", context->indent * 4, ' ',
+                over_threshold, context->slice_threshold);
+    }
+
+    CHK(sum <= context->picture_size - context->picture_header_size - (uint64_t)number_of_slices * 2);
+    *slice_data_size = (uint32_t)sum;
+
+    context->indent--;
+
+    return 1;
+}
+
 static int picture(ParseContext *context, int temporal_order)
 {
+    int64_t file_pos;
+    uint32_t slice_data_size;
+
     print_structure_start(context, "picture");
+    file_pos = get_file_pos(context);
 
     context->indent++;
 
-    picture_header(context);
+    CHK(picture_header(context));
+    CHK(slice_table(context, temporal_order, &slice_data_size));
 
-    CHK(skip_bytes_align(context, context->picture_size - context->picture_header_size));
+    // the slices are skipped
+    CHK(skip_bytes_align(context, context->picture_size - (get_file_pos(context) - file_pos)));
 
     context->indent--;
 
@@ -389,7 +618,7 @@ static int frame_header(ParseContext *context)
     int load_chroma_quantization_matrix;
     int64_t file_pos = get_file_pos(context);
 
-    printf("%*c frame_header:\n", context->indent * 4, ' ');
+    fprintf(context->out, "%*c frame_header:\n", context->indent * 4, ' ');
 
     context->indent++;
 
@@ -399,10 +628,13 @@ static int frame_header(ParseContext *context)
     u(8);  PRINT_UINT("bitstream_version");
     f(32); print_fourcc(context, "encoder_identifier");
     u(16); PRINT_UINT("horizontal_size");
+    context->horizontal_size = (uint16_t)context->value;
     u(16); PRINT_UINT("vertical_size");
+    context->vertical_size = (uint16_t)context->value;
     u(2);  PRINT_ENUM("chroma_format", CHROMA_FORMAT_STRINGS, "");
     u(2);  PRINT_UINT8_HEX("reserved");
     u(2);  PRINT_ENUM("interlace_mode", INTERLACE_MODE_STRINGS, "");
+    context->interlace_mode = (uint8_t)context->value;
     u(2);  PRINT_UINT8_HEX("reserved");
     u(4);  PRINT_ENUM("aspect_ratio_information", ASPECT_RATIO_STRINGS, "Reserved");
     u(4);  PRINT_ENUM("frame_rate_code", FRAME_RATE_STRINGS, "Reserved");
@@ -433,12 +665,11 @@ static int frame_header(ParseContext *context)
 
 static int frame(ParseContext *context)
 {
-    static const uint32_t RDD36_FRAME_ID = 0x69637066; // 'icpf'
     uint32_t frame_size;
     int64_t file_pos = get_file_pos(context);
     int64_t stuffing_size;
 
-    printf("frame: num=%" PRId64 ", pos=%" PRId64 "\n", context->frame_count, file_pos);
+    fprintf(context->out, "frame: num=%" PRId64 ", pos=%" PRId64 "\n", context->frame_count, file_pos);
 
     context->indent++;
 
@@ -447,6 +678,11 @@ static int frame(ParseContext *context)
     f(32);  print_fourcc(context, "frame_identifier");
     CHK(context->value == RDD36_FRAME_ID);
     CHK(frame_header(context));
+    if (context->header_only) {
+        CHK(skip_bytes_align(context, frame_size - (get_file_pos(context) - file_pos)));
+        context->indent--;
+        return 1;
+    }
     CHK(picture(context, 1));
     if (context->interlace_mode == 1 || context->interlace_mode == 2)
         CHK(picture(context, 2));
@@ -459,28 +695,520 @@ static int frame(ParseContext *context)
     return 1;
 }
 
-static int read_next_frame_offset(FILE *offsets_file, int64_t *offset_out)
+static int read_quantization_matrix(ParseContext *context, uint8_t *matrix)
+{
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        u(8); matrix[i] = (uint8_t)context->value;
+    }
+
+    return 1;
+}
+
+// Parses the frame_header fields into a signature without printing them and skips the rest of the frame
+static int frame_signature(ParseContext *context, HeaderSignature *signature, uint32_t *frame_size_out)
+{
+    uint32_t frame_size;
+    uint16_t frame_header_size;
+    int64_t file_pos = get_file_pos(context);
+    int64_t header_pos;
+
+    memset(signature, 0, sizeof(*signature));
+
+    u(32); frame_size = (uint32_t)context->value;
+    f(32); CHK(context->value == RDD36_FRAME_ID);
+
+    header_pos = get_file_pos(context);
+    u(16); frame_header_size = (uint16_t)context->value;
+    u(8);
+    u(8);  signature->bitstream_version = (uint8_t)context->value;
+    f(32); signature->encoder_identifier = (uint32_t)context->value;
+    u(16); signature->horizontal_size = (uint16_t)context->value;
+    u(16); signature->vertical_size = (uint16_t)context->value;
+    u(2);  signature->chroma_format = (uint8_t)context->value;
+    u(2);
+    u(2);  signature->interlace_mode = (uint8_t)context->value;
+    u(2);
+    u(4);  signature->aspect_ratio_information = (uint8_t)context->value;
+    u(4);  signature->frame_rate_code = (uint8_t)context->value;
+    u(8);  signature->color_primaries = (uint8_t)context->value;
+    u(8);  signature->transfer_characteristic = (uint8_t)context->value;
+    u(8);  signature->matrix_coefficients = (uint8_t)context->value;
+    u(4);
+    u(4);  signature->alpha_channel_type = (uint8_t)context->value;
+    u(14);
+    u(1);  signature->load_luma_quantization_matrix = (uint8_t)context->value;
+    u(1);  signature->load_chroma_quantization_matrix = (uint8_t)context->value;
+    if (signature->load_luma_quantization_matrix)
+        CHK(read_quantization_matrix(context, signature->luma_quantization_matrix));
+    if (signature->load_chroma_quantization_matrix)
+        CHK(read_quantization_matrix(context, signature->chroma_quantization_matrix));
+    CHK(frame_header_size >= get_file_pos(context) - header_pos);
+
+    CHK(skip_bytes_align(context, frame_size - (get_file_pos(context) - file_pos)));
+    if (frame_size_out)
+        *frame_size_out = frame_size;
+
+    return 1;
+}
+
+static void add_signature(SignatureTable *table, const HeaderSignature *signature, uint64_t hash, int64_t count,
+                          int64_t first_frame, int64_t last_frame)
 {
-    char line[1024];
+    SignatureEntry *entry;
     size_t i;
 
-    while (1) {
-        if (!fgets(line, sizeof(line), offsets_file))
+    table->num_frames += count;
+
+    i = (size_t)(hash & (SIGNATURE_TABLE_SIZE - 1));
+    while (table->entries[i].used) {
+        entry = &table->entries[i];
+        if (entry->hash == hash && memcmp(&entry->signature, signature, sizeof(*signature)) == 0) {
+            entry->count += count;
+            if (first_frame < entry->first_frame)
+                entry->first_frame = first_frame;
+            if (last_frame > entry->last_frame)
+                entry->last_frame = last_frame;
+            return;
+        }
+        i = (i + 1) & (SIGNATURE_TABLE_SIZE - 1);
+    }
+
+    if (table->num_signatures >= MAX_SIGNATURES) {
+        table->other_count += count;
+        return;
+    }
+
+    entry = &table->entries[i];
+    entry->signature   = *signature;
+    entry->hash        = hash;
+    entry->count       = count;
+    entry->first_frame = first_frame;
+    entry->last_frame  = last_frame;
+    entry->used        = 1;
+    table->num_signatures++;
+}
+
+static void merge_signatures(SignatureTable *table, const SignatureTable *other)
+{
+    size_t i;
+
+    for (i = 0; i < SIGNATURE_TABLE_SIZE; i++) {
+        const SignatureEntry *entry = &other->entries[i];
+        if (entry->used) {
+            add_signature(table, &entry->signature, entry->hash, entry->count, entry->first_frame,
+                          entry->last_frame);
+        }
+    }
+    table->num_frames  += other->other_count;
+    table->other_count += other->other_count;
+}
+
+static int summarize_frame(ParseContext *context)
+{
+    HeaderSignature signature;
+
+    CHK(frame_signature(context, &signature, NULL));
+    add_signature(context->signatures, &signature,
+                  frame_index_hash((const unsigned char*)&signature, sizeof(signature)),
+                  1, context->frame_count, context->frame_count);
+
+    return 1;
+}
+
+static void print_disagreement(ParseContext *context, int64_t file_pos, const char *name, uint64_t value,
+                               const char *mov_name, uint64_t mov_value)
+{
+    fprintf(context->out, "frame: num=%" PRId64 ", pos=%" PRId64 ": %s %" PRIu64 " != %s %" PRIu64 "\n",
+            context->frame_count, file_pos, name, value, mov_name, mov_value);
+    context->disagreement_count++;
+}
+
+// The 'fiel' detail is 1 or 14 if the top field is displayed first and 6 or 9 if the bottom field is displayed
+// first. The interlace_mode gives the temporal order of the fields
+static int fiel_detail_matches(uint8_t interlace_mode, uint8_t fiel_detail)
+{
+    if (fiel_detail == 1 || fiel_detail == 14)
+        return interlace_mode == 1;
+    else if (fiel_detail == 6 || fiel_detail == 9)
+        return interlace_mode == 2;
+    else
+        return 1;
+}
+
+static void print_invalid_frame(ParseContext *context, int64_t file_pos, const char *reason)
+{
+    fprintf(context->out, "frame: num=%" PRId64 ", pos=%" PRId64 ": %s\n", context->frame_count, file_pos, reason);
+    context->disagreement_count++;
+}
+
+// Compares the frame_header with the sample size and the video sample description in the 'moov' atom.
+// Each disagreement is printed. A frame that is truncated, doesn't start with the 'icpf' frame_identifier or has
+// an invalid frame_header is reported as a disagreement and the check continues with the next frame. Only file
+// I/O errors stop the check
+static int check_frame(ParseContext *context)
+{
+    const MOVInfo *info = context->check_info;
+    HeaderSignature signature;
+    uint32_t frame_size;
+    int64_t file_pos = get_file_pos(context);
+
+    context->check_frame_count++;
+
+    if (!read_bits(context, 32) || !read_bits(context, 32)) {
+        if (context->io_error)
             return 0;
-        for (i = 0; i < sizeof(line); i++) {
-            if ((line[i] >= '0' && line[i] <= '9') || !line[i])
-                break;
+        print_invalid_frame(context, file_pos, "truncated frame");
+        return 1;
+    }
+    if (context->value != RDD36_FRAME_ID) {
+        print_invalid_frame(context, file_pos, "missing 'icpf' frame_identifier");
+        return 1;
+    }
+
+    CHK(seek_to_offset(context, file_pos));
+    if (!frame_signature(context, &signature, &frame_size)) {
+        if (context->io_error)
+            return 0;
+        print_invalid_frame(context, file_pos, "invalid frame_header");
+        return 1;
+    }
+
+    if (frame_size != context->sample_size)
+        print_disagreement(context, file_pos, "frame_size", frame_size, "'stsz' sample size", context->sample_size);
+
+    if (info->have_sample_entry) {
+        if (signature.horizontal_size != info->width) {
+            print_disagreement(context, file_pos, "horizontal_size", signature.horizontal_size,
+                               "'stsd' width", info->width);
         }
-        if (i < sizeof(line) && line[i]) {
-            int64_t offset;
-            if (sscanf(&line[i], "%" PRId64, &offset) == 1 && offset >= 0) {
-                *offset_out = offset;
-                return 1;
-            }
+        if (signature.vertical_size != info->height) {
+            print_disagreement(context, file_pos, "vertical_size", signature.vertical_size,
+                               "'stsd' height", info->height);
+        }
+    }
+
+    if (info->have_colr) {
+        if (signature.color_primaries != info->colr[0]) {
+            print_disagreement(context, file_pos, "color_primaries", signature.color_primaries,
+                               "'colr' primaries", info->colr[0]);
+        }
+        if (signature.transfer_characteristic != info->colr[1]) {
+            print_disagreement(context, file_pos, "transfer_characteristic", signature.transfer_characteristic,
+                               "'colr' transfer function", info->colr[1]);
+        }
+        if (signature.matrix_coefficients != info->colr[2]) {
+            print_disagreement(context, file_pos, "matrix_coefficients", signature.matrix_coefficients,
+                               "'colr' matrix", info->colr[2]);
+        }
+    }
+
+    if (info->have_fiel) {
+        if (info->fiel_fields != (signature.interlace_mode == 0 ? 1 : 2)) {
+            print_disagreement(context, file_pos, "interlace_mode", signature.interlace_mode,
+                               "'fiel' fields", info->fiel_fields);
+        } else if (info->fiel_fields == 2 && !fiel_detail_matches(signature.interlace_mode, info->fiel_detail)) {
+            print_disagreement(context, file_pos, "interlace_mode", signature.interlace_mode,
+                               "'fiel' detail", info->fiel_detail);
         }
     }
 
-    return 0;
+    return 1;
+}
+
+static int process_frame(ParseContext *context)
+{
+    if (context->signatures)
+        return summarize_frame(context);
+    else if (context->check_info)
+        return check_frame(context);
+    else
+        return frame(context);
+}
+
+static void print_quantization_matrix(ParseContext *context, const char *name, const uint8_t *matrix)
+{
+    int u, v;
+
+    fprintf(context->out, "%*c %s:\n", context->indent * 4, ' ', name);
+
+    context->indent++;
+
+    for (v = 0; v < 8; v++) {
+        fprintf(context->out, "%*c ", context->indent * 4, ' ');
+        for (u = 0; u < 8; u++)
+            fprintf(context->out, " %02x", matrix[v * 8 + u]);
+        fprintf(context->out, "\n");
+    }
+
+    context->indent--;
+}
+
+static int compare_signature_entries(const void *left, const void *right)
+{
+    int64_t left_frame  = (*(const SignatureEntry**)left)->first_frame;
+    int64_t right_frame = (*(const SignatureEntry**)right)->first_frame;
+
+    return (left_frame > right_frame) - (left_frame < right_frame);
+}
+
+// Prints the distinct signatures in the order in which they first appear
+static void print_signatures(ParseContext *context, const SignatureTable *table)
+{
+    const SignatureEntry *entries[SIGNATURE_TABLE_SIZE];
+    const HeaderSignature *signature;
+    size_t num_entries = 0;
+    size_t i;
+
+    for (i = 0; i < SIGNATURE_TABLE_SIZE; i++) {
+        if (table->entries[i].used)
+            entries[num_entries++] = &table->entries[i];
+    }
+    qsort(entries, num_entries, sizeof(entries[0]), compare_signature_entries);
+
+    fprintf(context->out, "header_signatures: frames=%" PRId64 ", distinct=%zu\n", table->num_frames,
+            table->num_signatures);
+
+    context->indent++;
+
+    for (i = 0; i < num_entries; i++) {
+        signature = &entries[i]->signature;
+
+        fprintf(context->out, "%*c signature: count=%" PRId64 ", first_frame=%" PRId64 ", last_frame=%" PRId64 "\n",
+                context->indent * 4, ' ', entries[i]->count, entries[i]->first_frame, entries[i]->last_frame);
+
+        context->indent++;
+
+        context->value = signature->bitstream_version;
+        PRINT_UINT("bitstream_version");
+        context->value = signature->encoder_identifier;
+        print_fourcc(context, "encoder_identifier");
+        context->value = signature->horizontal_size;
+        PRINT_UINT("horizontal_size");
+        context->value = signature->vertical_size;
+        PRINT_UINT("vertical_size");
+        context->value = signature->chroma_format;
+        PRINT_ENUM("chroma_format", CHROMA_FORMAT_STRINGS, "");
+        context->value = signature->interlace_mode;
+        PRINT_ENUM("interlace_mode", INTERLACE_MODE_STRINGS, "");
+        context->value = signature->aspect_ratio_information;
+        PRINT_ENUM("aspect_ratio_information", ASPECT_RATIO_STRINGS, "Reserved");
+        context->value = signature->frame_rate_code;
+        PRINT_ENUM("frame_rate_code", FRAME_RATE_STRINGS, "Reserved");
+        context->value = signature->color_primaries;
+        PRINT_ENUM("color_primaries", COLOR_PRIMARY_STRINGS, "Reserved");
+        context->value = signature->transfer_characteristic;
+        PRINT_ENUM("transfer_characteristic", TRANSFER_CHAR_STRINGS, "Reserved");
+        context->value = signature->matrix_coefficients;
+        PRINT_ENUM("matrix_coefficients", MATRIX_COEFF_STRINGS, "Reserved");
+        context->value = signature->alpha_channel_type;
+        PRINT_ENUM("alpha_channel_type", ALPHA_CHANNEL_TYPE_STRINGS, "Reserved");
+        if (signature->load_luma_quantization_matrix)
+            print_quantization_matrix(context, "luma_quantization_matrix", signature->luma_quantization_matrix);
+        if (signature->load_chroma_quantization_matrix)
+            print_quantization_matrix(context, "chroma_quantization_matrix", signature->chroma_quantization_matrix);
+
+        context->indent--;
+    }
+    if (table->other_count > 0) {
+        fprintf(context->out, "%*c other: count=%" PRId64 " (frames with more than %d distinct signatures)\n",
+                context->indent * 4, ' ', table->other_count, MAX_SIGNATURES);
+    }
+
+    context->indent--;
+}
+
+typedef struct
+{
+    char *data;
+    size_t size;
+    int done;
+    int result;
+} DumpChunk;
+
+typedef struct
+{
+    ParseContext *context;
+    struct DumpJobs *jobs;
+    pthread_t thread;
+    int started;
+} DumpWorker;
+
+typedef struct DumpJobs
+{
+    const FrameIndex *index;
+    DumpChunk *chunks;
+    size_t num_chunks;
+    size_t next_chunk;
+    size_t written_chunks;
+    size_t max_pending_chunks;
+    int abort;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} DumpJobs;
+
+
+static int dump_frame_range(ParseContext *context, const FrameIndex *index, size_t begin, size_t end,
+                            DumpChunk *chunk)
+{
+    size_t i;
+
+    // the summary is only output once all frames have been parsed
+    if (!context->signatures) {
+        context->out = open_memstream(&chunk->data, &chunk->size);
+        CHK(context->out);
+    }
+
+    chunk->result = 1;
+    for (i = begin; i < end; i++) {
+        context->frame_count = index->entries[i].frame_num;
+        context->sample_size = index->entries[i].size;
+        if (!seek_to_offset(context, index->entries[i].offset) || !process_frame(context)) {
+            chunk->result = 0;
+            break;
+        }
+    }
+
+    if (!context->signatures) {
+        fclose(context->out);
+        context->out = NULL;
+    }
+
+    return 1;
+}
+
+static void* dump_thread(void *arg)
+{
+    DumpWorker *worker = (DumpWorker*)arg;
+    DumpJobs *jobs = worker->jobs;
+    DumpChunk chunk;
+    size_t chunk_index;
+    size_t end;
+
+    while (1) {
+        // limit the number of chunks that are waiting to be written to stdout
+        pthread_mutex_lock(&jobs->mutex);
+        while (!jobs->abort && jobs->next_chunk < jobs->num_chunks &&
+               jobs->next_chunk >= jobs->written_chunks + jobs->max_pending_chunks)
+        {
+            pthread_cond_wait(&jobs->cond, &jobs->mutex);
+        }
+        if (jobs->abort || jobs->next_chunk >= jobs->num_chunks) {
+            pthread_mutex_unlock(&jobs->mutex);
+            break;
+        }
+        chunk_index = jobs->next_chunk++;
+        pthread_mutex_unlock(&jobs->mutex);
+
+        memset(&chunk, 0, sizeof(chunk));
+        end = (chunk_index + 1) * CHUNK_FRAME_COUNT;
+        if (end > jobs->index->count)
+            end = jobs->index->count;
+        if (!dump_frame_range(worker->context, jobs->index, chunk_index * CHUNK_FRAME_COUNT, end, &chunk))
+            chunk.result = 0;
+
+        pthread_mutex_lock(&jobs->mutex);
+        jobs->chunks[chunk_index] = chunk;
+        jobs->chunks[chunk_index].done = 1;
+        pthread_cond_broadcast(&jobs->cond);
+        pthread_mutex_unlock(&jobs->mutex);
+    }
+
+    return NULL;
+}
+
+// Parses chunks of frames on worker threads into memory buffers, which are written to stdout in
+// frame order
+static int dump_frames_threaded(ParseContext *contexts, unsigned num_threads, const FrameIndex *index)
+{
+    DumpJobs jobs;
+    DumpWorker *workers;
+    unsigned num_started = 0;
+    size_t i;
+    int result = 1;
+
+    memset(&jobs, 0, sizeof(jobs));
+    jobs.index = index;
+    jobs.num_chunks = (index->count + CHUNK_FRAME_COUNT - 1) / CHUNK_FRAME_COUNT;
+    jobs.max_pending_chunks = (size_t)num_threads * MAX_PENDING_CHUNKS;
+    jobs.chunks = (DumpChunk*)calloc(jobs.num_chunks + 1, sizeof(DumpChunk));
+    workers = (DumpWorker*)calloc(num_threads, sizeof(DumpWorker));
+    if (!jobs.chunks || !workers) {
+        fprintf(stderr, "Failed to allocate dump chunks\n");
+        free(jobs.chunks);
+        free(workers);
+        return 0;
+    }
+    pthread_mutex_init(&jobs.mutex, NULL);
+    pthread_cond_init(&jobs.cond, NULL);
+
+    for (i = 0; i < num_threads; i++) {
+        workers[i].context = &contexts[i];
+        workers[i].jobs    = &jobs;
+        errno = pthread_create(&workers[i].thread, NULL, dump_thread, &workers[i]);
+        if (errno) {
+            fprintf(stderr, "Failed to create thread: %s\n", strerror(errno));
+        } else {
+            workers[i].started = 1;
+            num_started++;
+        }
+    }
+    if (num_started == 0)
+        result = 0;
+
+    for (i = 0; i < jobs.num_chunks && result; i++) {
+        pthread_mutex_lock(&jobs.mutex);
+        while (!jobs.chunks[i].done)
+            pthread_cond_wait(&jobs.cond, &jobs.mutex);
+        pthread_mutex_unlock(&jobs.mutex);
+
+        fwrite(jobs.chunks[i].data, 1, jobs.chunks[i].size, stdout);
+        free(jobs.chunks[i].data);
+        jobs.chunks[i].data = NULL;
+        if (!jobs.chunks[i].result)
+            result = 0;
+
+        pthread_mutex_lock(&jobs.mutex);
+        jobs.written_chunks++;
+        if (!result)
+            jobs.abort = 1;
+        pthread_cond_broadcast(&jobs.cond);
+        pthread_mutex_unlock(&jobs.mutex);
+    }
+
+    for (i = 0; i < num_threads; i++) {
+        if (workers[i].started)
+            pthread_join(workers[i].thread, NULL);
+    }
+    for (i = 0; i < jobs.num_chunks; i++)
+        free(jobs.chunks[i].data);
+
+    pthread_cond_destroy(&jobs.cond);
+    pthread_mutex_destroy(&jobs.mutex);
+    free(jobs.chunks);
+    free(workers);
+
+    return result;
+}
+
+static int open_context(ParseContext *context, const char *filename, int header_only, int64_t slice_threshold)
+{
+    memset(context, 0, sizeof(*context));
+    context->out = stdout;
+    context->header_only = header_only;
+    context->slice_threshold = slice_threshold;
+    // only a small read is required to parse the frame_header if the pictures are skipped
+    context->read_size = (header_only ? HEADER_READ_SIZE : READ_BUFFER_SIZE);
+    context->file = fopen(filename, "rb");
+    if (!context->file) {
+        fprintf(stderr, "Failed to open input file '%s': %s\n", filename, strerror(errno));
+        return 0;
+    }
+    // the file data is read into the context's buffer
+    setvbuf(context->file, NULL, _IONBF, 0);
+
+    return 1;
 }
 
 static void print_usage(const char *cmd)
@@ -491,18 +1219,54 @@ static void print_usage(const char *cmd)
     fprintf(stderr, "  --offsets <file>     Text file containing decimal file offsets for each frame separated by newlines\n");
     fprintf(stderr, "                       E.g. using ffprobe to extract offsets from a Quicktime file:\n");
     fprintf(stderr, "                           'ffprobe -show_packets -select_streams v:0 example.mov | grep pos >offsets.txt'\n");
+    fprintf(stderr, "  --mov                Resolve frame offsets from the sample tables of the first video track in a Quicktime file\n");
+    fprintf(stderr, "  --scan               Locate the frames by searching for the 'icpf' frame_identifier rather than walking\n");
+    fprintf(stderr, "                       the frame_size fields, e.g. a raw bitstream with padding or a Quicktime file\n");
+    fprintf(stderr, "                       without usable sample tables where the frames are interleaved with audio\n");
+    fprintf(stderr, "  --index <file>       Binary frame index file created using '--write-index'\n");
+    fprintf(stderr, "  --write-index <file> Write a binary frame index file that can be used with '--index'\n");
+    fprintf(stderr, "  --header-only        Only dump the frame_header and skip the pictures and stuffing in each frame\n");
+    fprintf(stderr, "  --summary            Print each distinct frame_header signature with the number of frames and the first\n");
+    fprintf(stderr, "                       and last frame number rather than dumping the frames\n");
+    fprintf(stderr, "  --check              Check that the frame_header of each frame agrees with the 'stsz' sample size and the\n");
+    fprintf(stderr, "                       'stsd' dimensions, 'colr' and 'fiel' atoms. Only the frame headers are read, each\n");
+    fprintf(stderr, "                       disagreement is printed and the exit status is non-zero if there are any. Requires '--mov'\n");
+    fprintf(stderr, "  --slice-threshold <bytes>\n");
+    fprintf(stderr, "                       Count the slices in each picture with a coded size larger than <bytes>\n");
+    fprintf(stderr, "  --start <frame>      Start dumping at frame number <frame>. Default 0\n");
+    fprintf(stderr, "  --count <n>          Dump at most <n> frames\n");
+    fprintf(stderr, "  --every <n>          Dump every <n>th frame. Default 1\n");
+    fprintf(stderr, "  -j <n>               Parse ranges of frames using <n> threads. The output is written in frame order\n");
 }
 
 int main(int argc, const char **argv)
 {
     const char *offsets_filename = NULL;
+    const char *index_filename = NULL;
+    const char *write_index_filename = NULL;
+    int use_mov_info = 0;
+    int scan_frames = 0;
+    int header_only = 0;
+    int summary = 0;
+    int check = 0;
+    int64_t check_frame_count = 0;
+    int64_t disagreement_count = 0;
+    int64_t slice_threshold = -1;
+    unsigned num_threads = 1;
+    int64_t start_frame = 0;
+    int64_t frame_count = -1;
+    int64_t frame_step = 1;
+    int select_frames;
     const char *filename;
     int cmdln_index;
-    ParseContext context;
-    FILE *offsets_file = NULL;
+    ParseContext *contexts;
+    FrameIndex offsets_index;
+    MOVInfo mov_info;
+    FrameIndex *frame_index = NULL;
+    unsigned i;
     int result = 0;
 
-    // TODO: options to limit the dump start and count
+    be_decode_init();
 
     if (argc <= 1) {
         print_usage(argv[0]);
@@ -527,6 +1291,129 @@ int main(int argc, const char **argv)
             offsets_filename = argv[cmdln_index + 1];
             cmdln_index++;
         }
+        else if (strcmp(argv[cmdln_index], "--index") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            index_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--write-index") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            write_index_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--mov") == 0)
+        {
+            use_mov_info = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--scan") == 0)
+        {
+            scan_frames = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--header-only") == 0)
+        {
+            header_only = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--summary") == 0)
+        {
+            summary = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--check") == 0)
+        {
+            check = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--slice-threshold") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &slice_threshold) != 1 || slice_threshold < 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--start") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &start_frame) != 1 || start_frame < 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--count") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &frame_count) != 1 || frame_count < 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--every") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &frame_step) != 1 || frame_step <= 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-j") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%u", &num_threads) != 1 ||
+                num_threads == 0 || num_threads > MAX_THREADS)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
         else
         {
             break;
@@ -545,44 +1432,144 @@ int main(int argc, const char **argv)
     }
 
     filename = argv[cmdln_index];
+    if (offsets_filename && use_mov_info) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Options '--offsets' and '--mov' can't be used together\n");
+        return 1;
+    }
+    if (index_filename && (offsets_filename || use_mov_info)) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--index' can't be used together with '--offsets' or '--mov'\n");
+        return 1;
+    }
+    if (scan_frames && (offsets_filename || use_mov_info || index_filename)) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--scan' can't be used together with '--offsets', '--mov' or '--index'\n");
+        return 1;
+    }
+    if (check && !use_mov_info) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--check' requires option '--mov'\n");
+        return 1;
+    }
+    if (check && summary) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Options '--check' and '--summary' can't be used together\n");
+        return 1;
+    }
+    select_frames = (start_frame > 0 || frame_count >= 0 || frame_step > 1);
 
-
-    memset(&context, 0, sizeof(context));
-    context.next_bit = -1;
-    context.file = fopen(filename, "rb");
-    if (!context.file) {
-        fprintf(stderr, "Failed to open input file '%s': %s\n", filename, strerror(errno));
+    contexts = (ParseContext*)calloc(num_threads, sizeof(ParseContext));
+    if (!contexts) {
+        fprintf(stderr, "Failed to allocate parse contexts\n");
         return 1;
     }
+    for (i = 0; i < num_threads; i++) {
+        if (!open_context(&contexts[i], filename, header_only || summary || check, slice_threshold))
+            return 1;
+        if (summary) {
+            contexts[i].signatures = (SignatureTable*)calloc(1, sizeof(SignatureTable));
+            if (!contexts[i].signatures) {
+                fprintf(stderr, "Failed to allocate signature table\n");
+                return 1;
+            }
+        }
+    }
+
+    frame_index_init(&offsets_index);
+    mov_info_init(&mov_info);
+    if (index_filename) {
+        if (!mov_read_frame_index_file(contexts[0].file, &offsets_index, index_filename))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (offsets_filename) {
+        if (!frame_index_read_offsets_file(&offsets_index, offsets_filename))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (use_mov_info) {
+        if (!mov_read_info(contexts[0].file, &mov_info)) {
+            fprintf(stderr, "Failed to read frame offsets from Quicktime file '%s'\n", filename);
+            return 1;
+        }
+        frame_index = &mov_info.frame_index;
+        if (check) {
+            for (i = 0; i < num_threads; i++)
+                contexts[i].check_info = &mov_info;
+        }
+    } else if (scan_frames) {
+        if (!frame_index_scan_file(&offsets_index, fileno(contexts[0].file), 0, -1))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (num_threads > 1 || select_frames || write_index_filename) {
+        // the frame ranges and selection require the offsets of the frames in the raw bitstream
+        if (!frame_index_scan_raw_file(&offsets_index, fileno(contexts[0].file)))
+            return 1;
+        frame_index = &offsets_index;
+    }
 
-    if (offsets_filename) {
-        offsets_file = fopen(offsets_filename, "rb");
-        if (!offsets_file) {
-            fprintf(stderr, "Failed to open offsets file '%s': %s\n", offsets_filename, strerror(errno));
+    if (write_index_filename) {
+        FrameIndexSource source;
+        if (!mov_get_frame_index_source(contexts[0].file, &source) ||
+            !frame_index_write_file(frame_index, &source, write_index_filename))
+        {
             return 1;
         }
     }
 
-    while (1) {
-        if (offsets_file) {
-            int64_t offset;
-            if (!read_next_frame_offset(offsets_file, &offset) || !seek_to_offset(&context, offset))
+    if (select_frames)
+        frame_index_select(frame_index, start_frame, frame_count, frame_step);
+
+    if (num_threads > 1) {
+        if (!dump_frames_threaded(contexts, num_threads, frame_index))
+            result = 1;
+    } else {
+        ParseContext *context = &contexts[0];
+        size_t index_pos = 0;
+        while (1) {
+            if (frame_index) {
+                if (index_pos >= frame_index->count ||
+                    !seek_to_offset(context, frame_index->entries[index_pos].offset))
+                {
+                    break;
+                }
+                context->frame_count = frame_index->entries[index_pos].frame_num;
+                context->sample_size = frame_index->entries[index_pos].size;
+                index_pos++;
+            } else if (!have_byte(context)) {
                 break;
-        } else if (!have_byte(&context)) {
-            break;
+            }
+            if (!process_frame(context)) {
+                result = 1;
+                break;
+            }
+            context->frame_count++;
         }
-        if (!frame(&context)) {
-            result = 1;
-            break;
+    }
+
+    if (summary) {
+        for (i = 1; i < num_threads; i++)
+            merge_signatures(contexts[0].signatures, contexts[i].signatures);
+        print_signatures(&contexts[0], contexts[0].signatures);
+    }
+    if (check) {
+        for (i = 0; i < num_threads; i++) {
+            check_frame_count  += contexts[i].check_frame_count;
+            disagreement_count += contexts[i].disagreement_count;
         }
-        context.frame_count++;
+        printf("check: frames=%" PRId64 ", disagreements=%" PRId64 "\n", check_frame_count, disagreement_count);
+        if (disagreement_count > 0)
+            result = 1;
     }
 
-    if (context.file)
-        fclose(context.file);
-    if (offsets_file)
-        fclose(offsets_file);
+    for (i = 0; i < num_threads; i++) {
+        if (contexts[i].file)
+            fclose(contexts[i].file);
+        free(contexts[i].signatures);
+    }
+    free(contexts);
+    frame_index_clear(&offsets_index);
+    mov_info_clear(&mov_info);
 
 
     return result;
-}
\ No newline at end of file
+}
@@ -29,6 +29,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
  
+#define _GNU_SOURCE     // copy_file_range
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -36,6 +38,23 @@
 #include <inttypes.h>
 #include <assert.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#ifdef HAVE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "movinfo.h"
+#include "bedecode.h"
 
 
 #define CHK(cmd)                                                                    \
@@ -47,6 +66,15 @@
     } while (0)
 
 
+typedef enum
+{
+    STDIO_IO,
+    MMAP_IO,
+    PWRITE_IO,
+    URING_IO,
+    STREAM_IO,
+} IOMethod;
+
 typedef struct
 {
     int skip_frame_data;
@@ -54,28 +82,106 @@ typedef struct
     int color_prim_update;
     int transfer_ch_update;
     int matrix_coeff_update;
+    int aspect_ratio_update;
+    int frame_rate_update;
+    int64_t update_count;
+    int pass_count;     // number of sweeps over the frames that updated the frame headers
 
     FILE *file;
     int eof;
 
+    uint8_t *map_data;
+    int64_t map_size;
+    int64_t map_pos;
+
     uint8_t current_byte;
     int next_bit;
     uint64_t value;
 } ParseContext;
 
 
+static const uint32_t RDD36_FRAME_ID         = 0x69637066; // 'icpf'
+static const int64_t  FRAME_HEADER_OFFSET    = 8;          // follows frame_size and frame_identifier
+static const int64_t  HEADER_PATCH_OFFSET    = 13;         // aspect_ratio_information and frame_rate_code byte
+                                                           // within the frame_header, followed by the colour bytes
+#define HEADER_PATCH_SIZE       4
+
+#define DEFAULT_QUEUE_DEPTH     64
+#define MAX_QUEUE_DEPTH         4096
+#define MAX_THREADS             256
+
+#define STREAM_BLOCK_SIZE       (8 * 1024 * 1024)
+#define STREAM_BLOCK_ALIGNMENT  4096
+
+#define MAX_VERIFY_REPORTS      10
+
+
+
+static int map_file(ParseContext *context)
+{
+    struct stat st;
+    int prot = PROT_READ;
+
+    if (fstat(fileno(context->file), &st) < 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        return 0;
+    }
+    if (st.st_size == 0)
+        return 1;
+
+    if (!context->show_props)
+        prot |= PROT_WRITE;
+    context->map_data = (uint8_t*)mmap(NULL, st.st_size, prot, MAP_SHARED, fileno(context->file), 0);
+    if (context->map_data == MAP_FAILED) {
+        context->map_data = NULL;
+        fprintf(stderr, "Failed to memory map file: %s\n", strerror(errno));
+        return 0;
+    }
+    context->map_size = st.st_size;
+    context->map_pos = 0;
+
+    // only the frame headers are accessed and so read-ahead of the frame data is avoided
+    madvise(context->map_data, context->map_size, MADV_RANDOM);
+
+    return 1;
+}
+
+static int unmap_file(ParseContext *context)
+{
+    int result = 1;
+
+    if (!context->map_data)
+        return 1;
+
+    if (!context->show_props && msync(context->map_data, context->map_size, MS_SYNC) < 0) {
+        fprintf(stderr, "Failed to sync memory mapped file: %s\n", strerror(errno));
+        result = 0;
+    }
+    munmap(context->map_data, context->map_size);
+    context->map_data = NULL;
+
+    return result;
+}
 
 static int read_next_byte(ParseContext *context)
 {
     int c;
 
-    c = fgetc(context->file);
-    if (c == EOF) {
-        if (feof(context->file))
+    if (context->map_data) {
+        if (context->map_pos >= context->map_size) {
             context->eof = 1;
-        else
-            fprintf(stderr, "File read error: %s\n", strerror(errno));
-        return 0;
+            return 0;
+        }
+        c = context->map_data[context->map_pos++];
+    } else {
+        c = fgetc(context->file);
+        if (c == EOF) {
+            if (feof(context->file))
+                context->eof = 1;
+            else
+                fprintf(stderr, "File read error: %s\n", strerror(errno));
+            return 0;
+        }
     }
 
     context->next_bit = 7;
@@ -86,13 +192,21 @@ static int read_next_byte(ParseContext *context)
 
 static int64_t get_file_pos(ParseContext *context)
 {
-    return ftello(context->file) - (context->next_bit >= 0 ? 1 : 0);
+    if (context->map_data)
+        return context->map_pos - (context->next_bit >= 0 ? 1 : 0);
+    else
+        return ftello(context->file) - (context->next_bit >= 0 ? 1 : 0);
 }
 
 static int seek_to_offset(ParseContext *context, int64_t offset)
 {
-    if (fseeko(context->file, offset, SEEK_SET) < 0)
+    if (context->map_data) {
+        if (offset < 0)
+            return 0;
+        context->map_pos = offset;
+    } else if (fseeko(context->file, offset, SEEK_SET) < 0) {
         return 0;
+    }
 
     context->next_bit = -1;
 
@@ -101,7 +215,14 @@ static int seek_to_offset(ParseContext *context, int64_t offset)
 
 static int update_file(ParseContext *context, const uint8_t *data, size_t size)
 {
-    if (fwrite(data, size, 1, context->file) != 1) {
+    if (context->map_data) {
+        if (context->map_pos + (int64_t)size > context->map_size) {
+            fprintf(stderr, "Failed to update file: update beyond end of file\n");
+            return 0;
+        }
+        memcpy(&context->map_data[context->map_pos], data, size);
+        context->map_pos += size;
+    } else if (fwrite(data, size, 1, context->file) != 1) {
         fprintf(stderr, "Failed to update file: %s\n", strerror(errno));
         return 0;
     }
@@ -126,6 +247,8 @@ static int skip_bytes_align(ParseContext *context, int64_t count)
 
     if (offset <= 0) {
         offset = 0;
+    } else if (context->map_data) {
+        context->map_pos += offset;
     } else if (fseeko(context->file, offset, SEEK_CUR) < 0) {
         fprintf(stderr, "Seek error: %s\n", strerror(errno));
         return 0;
@@ -157,32 +280,58 @@ static int read_bits(ParseContext *context, int n)
 #define f(a)  CHK(read_bits(context, a))
 #define u(a)  CHK(read_bits(context, a))
 
+static void print_props(const uint8_t *header)
+{
+    printf("First frame properties:\n");
+    printf("  aspect_ratio_information: %u\n", header[0] >> 4);
+    printf("  frame_rate_code         : %u\n", header[0] & 0x0f);
+    printf("  color_primaries         : %u\n", header[1]);
+    printf("  transfer_characteristic : %u\n", header[2]);
+    printf("  matrix_coefficients     : %u\n", header[3]);
+}
+
+static void print_colr_props(const uint16_t *colr)
+{
+    printf("Quicktime 'colr' atom properties:\n");
+    printf("  color_primaries         : %u\n", colr[0]);
+    printf("  transfer_characteristic : %u\n", colr[1]);
+    printf("  matrix_coefficients     : %u\n", colr[2]);
+}
+
+static void update_header(const ParseContext *context, uint8_t *header)
+{
+    if (context->aspect_ratio_update >= 0)
+        header[0] = (uint8_t)((context->aspect_ratio_update << 4) | (header[0] & 0x0f));
+    if (context->frame_rate_update >= 0)
+        header[0] = (uint8_t)((header[0] & 0xf0) | context->frame_rate_update);
+    if (context->color_prim_update >= 0)
+        header[1] = (uint8_t)context->color_prim_update;
+    if (context->transfer_ch_update >= 0)
+        header[2] = (uint8_t)context->transfer_ch_update;
+    if (context->matrix_coeff_update >= 0)
+        header[3] = (uint8_t)context->matrix_coeff_update;
+}
+
 static int frame_header(ParseContext *context)
 {
-    static const int64_t COLOR_PRIMARIES_OFFSET = 14;
-    uint8_t color_primaries;
-    uint8_t transfer_characteristic;
-    uint8_t matrix_coefficients;
+    uint8_t header[HEADER_PATCH_SIZE];
     int64_t file_pos = get_file_pos(context);
 
-    CHK(seek_to_offset(context, file_pos + COLOR_PRIMARIES_OFFSET));
+    CHK(seek_to_offset(context, file_pos + HEADER_PATCH_OFFSET));
 
-    u(8); color_primaries         = (uint8_t)context->value;
-    u(8); transfer_characteristic = (uint8_t)context->value;
-    u(8); matrix_coefficients     = (uint8_t)context->value;
+    u(8); header[0] = (uint8_t)context->value; // aspect_ratio_information and frame_rate_code
+    u(8); header[1] = (uint8_t)context->value; // color_primaries
+    u(8); header[2] = (uint8_t)context->value; // transfer_characteristic
+    u(8); header[3] = (uint8_t)context->value; // matrix_coefficients
 
     if (context->show_props) {
-        printf("First frame properties:\n");
-        printf("  color_primaries         : %u\n", color_primaries);
-        printf("  transfer_characteristic : %u\n", transfer_characteristic);
-        printf("  matrix_coefficients     : %u\n", matrix_coefficients);
+        print_props(header);
     } else {
-        uint8_t update[3];
-        update[0] = (context->color_prim_update >= 0   ? context->color_prim_update   : color_primaries); 
-        update[1] = (context->transfer_ch_update >= 0  ? context->transfer_ch_update  : transfer_characteristic); 
-        update[2] = (context->matrix_coeff_update >= 0 ? context->matrix_coeff_update : matrix_coefficients); 
-        CHK(seek_to_offset(context, file_pos + COLOR_PRIMARIES_OFFSET));
-        CHK(update_file(context, update, sizeof(update)));
+        // all the requested fields are updated with a single write
+        update_header(context, header);
+        CHK(seek_to_offset(context, file_pos + HEADER_PATCH_OFFSET));
+        CHK(update_file(context, header, sizeof(header)));
+        context->update_count++;
     }
 
     return 1;
@@ -190,7 +339,6 @@ static int frame_header(ParseContext *context)
 
 static int frame(ParseContext *context)
 {
-    static const uint32_t RDD36_FRAME_ID = 0x69637066; // 'icpf'
     uint32_t frame_size;
     int64_t file_pos = get_file_pos(context);
     int64_t skip_size;
@@ -209,198 +357,1442 @@ static int frame(ParseContext *context)
     return 1;
 }
 
-static int read_next_frame_offset(FILE *offsets_file, int64_t *offset_out)
+static uint32_t get_uint32(const uint8_t *bytes)
+{
+    return (((uint32_t)bytes[0]) << 24) |
+           (((uint32_t)bytes[1]) << 16) |
+           (((uint32_t)bytes[2]) << 8) |
+             (uint32_t)bytes[3];
+}
+
+static void get_colr_patch(const ParseContext *context, const MOVInfo *mov_info, uint8_t *bytes)
+{
+    uint16_t colr[3];
+    int i;
+
+    memcpy(colr, mov_info->colr, sizeof(colr));
+    if (context->color_prim_update >= 0)
+        colr[0] = (uint16_t)context->color_prim_update;
+    if (context->transfer_ch_update >= 0)
+        colr[1] = (uint16_t)context->transfer_ch_update;
+    if (context->matrix_coeff_update >= 0)
+        colr[2] = (uint16_t)context->matrix_coeff_update;
+    for (i = 0; i < 3; i++) {
+        bytes[i * 2]     = (uint8_t)(colr[i] >> 8);
+        bytes[i * 2 + 1] = (uint8_t)colr[i];
+    }
+}
+
+static int update_colr_atom(const ParseContext *context, const MOVInfo *mov_info)
+{
+    uint8_t bytes[6];
+
+    get_colr_patch(context, mov_info, bytes);
+    if (pwrite(fileno(context->file), bytes, sizeof(bytes), mov_info->colr_offset) != sizeof(bytes)) {
+        fprintf(stderr, "Failed to update 'colr' atom: %s\n", strerror(errno));
+        return 0;
+    }
+
+    return 1;
+}
+
+static int verify_value(const char *location, const char *name, int expected, unsigned value)
+{
+    if (expected >= 0 && (unsigned)expected != value) {
+        fprintf(stderr, "Verification failed: %s '%s' is %u but expected %d\n", location, name, value, expected);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Returns the end of the group of sorted frames starting at <begin> with headers that fit in the page
+// containing the first frame's header. The group is read and written with a single pread and pwrite
+static size_t get_header_group(const FrameIndex *index, size_t begin, size_t end_index, int64_t page_size,
+                               int64_t *end)
 {
-    char line[1024];
+    const int64_t patch_end = FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET + HEADER_PATCH_SIZE;
+    int64_t start = index->entries[begin].offset;
+    int64_t group_end = (start / page_size + 1) * page_size;
     size_t i;
 
-    while (1) {
-        if (!fgets(line, sizeof(line), offsets_file))
-            return 0;
-        for (i = 0; i < sizeof(line); i++) {
-            if ((line[i] >= '0' && line[i] <= '9') || !line[i])
-                break;
+    if (group_end < start + patch_end)
+        group_end = start + patch_end;
+    for (i = begin + 1; i < end_index && index->entries[i].offset + patch_end <= group_end; i++) {
+    }
+    *end = index->entries[i - 1].offset + patch_end;
+
+    return i;
+}
+
+// Reads back the frame headers in the sorted <index> and checks they contain the requested values.
+// The number of frames that failed verification is returned in <num_failed>
+static int verify_frame_headers(const ParseContext *context, int fd, const FrameIndex *index, int64_t *num_failed)
+{
+    const int64_t patch_offset = FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET;
+    const int64_t patch_end = patch_offset + HEADER_PATCH_SIZE;
+    int64_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t expected[HEADER_PATCH_SIZE];
+    uint8_t *buffer;
+    size_t i, j, k;
+    int result = 1;
+
+    buffer = (uint8_t*)malloc(page_size + patch_end);
+    CHK(buffer);
+
+    *num_failed = 0;
+    for (i = 0; i < index->count; i = j) {
+        int64_t start = index->entries[i].offset;
+        int64_t end;
+        ssize_t num_read;
+
+        j = get_header_group(index, i, index->count, page_size, &end);
+        num_read = pread(fd, buffer, end - start, start);
+        if (num_read < 0) {
+            fprintf(stderr, "File read error: %s\n", strerror(errno));
+            result = 0;
+            break;
         }
-        if (i < sizeof(line) && line[i]) {
-            int64_t offset;
-            if (sscanf(&line[i], "%" PRId64, &offset) == 1 && offset >= 0) {
-                *offset_out = offset;
-                return 1;
+
+        for (k = i; k < j; k++) {
+            int64_t pos = index->entries[k].offset - start;
+            const uint8_t *frame_bytes = &buffer[pos];
+
+            if (pos + patch_end <= num_read && get_uint32(&frame_bytes[4]) == RDD36_FRAME_ID) {
+                // the update doesn't change a header that already has the requested values
+                memcpy(expected, &frame_bytes[patch_offset], sizeof(expected));
+                update_header(context, expected);
+                if (memcmp(expected, &frame_bytes[patch_offset], sizeof(expected)) == 0)
+                    continue;
+            }
+            if (*num_failed < MAX_VERIFY_REPORTS) {
+                fprintf(stderr, "Verification failed: frame header at offset %" PRId64 " wasn't updated\n",
+                        index->entries[k].offset);
             }
+            (*num_failed)++;
         }
     }
 
-    return 0;
-}
+    free(buffer);
 
-static void print_usage(const char *cmd)
-{
-    fprintf(stderr, "Usage: %s [options] <filename>\n", cmd);
-    fprintf(stderr, "Options:\n");
-    fprintf(stderr, "  -h | --help    Show help and exit\n");
-    fprintf(stderr, "  -s             Show properties in the first frame and exit\n");
-    fprintf(stderr, "  -p <val>       Modify the 'color_primaries' property to <val>\n");
-    fprintf(stderr, "  -t <val>       Modify the 'transfer_characteristic' property to <val>\n");
-    fprintf(stderr, "  -m <val>       Modify the 'matrix_coefficients' property to <val>\n");
-    fprintf(stderr, "  -o <file>      Text file containing decimal file offsets for each frame separated by a newline\n");
-    fprintf(stderr, "                     E.g. using ffprobe to extract offsets from a Quicktime file:\n");
-    fprintf(stderr, "                     'ffprobe -show_packets -select_streams v:0 example.mov | grep pos >offsets.txt'\n");
+    return result;
 }
 
-int main(int argc, const char **argv)
+// Reads back every updated frame header and the 'colr' atom after the update and checks they
+// contain the requested values
+static int verify_update(const ParseContext *context, const FrameIndex *index, const MOVInfo *colr_info)
 {
-    const char *offsets_filename = NULL;
-    const char *filename;
-    int cmdln_index;
-    ParseContext context;
-    FILE *offsets_file = NULL;
-    int result = 0;
-
-    memset(&context, 0, sizeof(context));
-    context.next_bit = -1;
-    context.transfer_ch_update = -1;
-    context.matrix_coeff_update = -1;
-    context.color_prim_update = -1;
+    int fd = fileno(context->file);
+    uint8_t bytes[6];
+    int64_t num_failed;
+    int result = 1;
 
-    if (argc <= 1) {
-        print_usage(argv[0]);
+    if (!verify_frame_headers(context, fd, index, &num_failed))
         return 0;
+    if (num_failed > 0) {
+        fprintf(stderr, "Verification failed for %" PRId64 " of %zu frame headers\n", num_failed, index->count);
+        result = 0;
     }
 
-    for (cmdln_index = 1; cmdln_index < argc; cmdln_index++) {
-        if (strcmp(argv[cmdln_index], "-h") == 0 ||
-            strcmp(argv[cmdln_index], "--help") == 0)
-        {
-            print_usage(argv[0]);
+    if (colr_info) {
+        if (pread(fd, bytes, 6, colr_info->colr_offset) != 6) {
+            fprintf(stderr, "Failed to read back the 'colr' atom: %s\n", strerror(errno));
             return 0;
         }
-        else if (strcmp(argv[cmdln_index], "-s") == 0)
-        {
-            context.show_props = 1;
-        }
-        else if (strcmp(argv[cmdln_index], "-t") == 0)
-        {
-            if (cmdln_index + 1 >= argc)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
-                return 1;
-            }
-            if (sscanf(argv[cmdln_index + 1], "%d", &context.transfer_ch_update) != 1 ||
-                context.transfer_ch_update < 0 || context.transfer_ch_update > 0xff)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
-                return 1;
-            }
-            cmdln_index++;
-        }
-        else if (strcmp(argv[cmdln_index], "-m") == 0)
-        {
-            if (cmdln_index + 1 >= argc)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
-                return 1;
-            }
-            if (sscanf(argv[cmdln_index + 1], "%d", &context.matrix_coeff_update) != 1 ||
-                context.matrix_coeff_update < 0 || context.matrix_coeff_update > 0xff)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
-                return 1;
-            }
-            cmdln_index++;
+        result &= verify_value("'colr' atom", "color_primaries", context->color_prim_update,
+                               (bytes[0] << 8) | bytes[1]);
+        result &= verify_value("'colr' atom", "transfer_characteristic", context->transfer_ch_update,
+                               (bytes[2] << 8) | bytes[3]);
+        result &= verify_value("'colr' atom", "matrix_coefficients", context->matrix_coeff_update,
+                               (bytes[4] << 8) | bytes[5]);
+    }
+
+    return result;
+}
+
+static int patch_frame_range(const ParseContext *context, int fd, const FrameIndex *index, size_t begin,
+                             size_t end_index, int64_t *update_count)
+{
+    const int64_t patch_offset = FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET;
+    const int64_t patch_end = patch_offset + HEADER_PATCH_SIZE;
+    int64_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t *buffer;
+    size_t i, j, k;
+    int result = 1;
+
+    buffer = (uint8_t*)malloc(page_size + patch_end);
+    CHK(buffer);
+
+    for (i = begin; i < end_index && result; i = j) {
+        int64_t start = index->entries[i].offset;
+        int64_t end;
+        ssize_t num_read;
+
+        j = get_header_group(index, i, end_index, page_size, &end);
+        num_read = pread(fd, buffer, end - start, start);
+        if (num_read != end - start) {
+            if (num_read < 0)
+                fprintf(stderr, "File read error: %s\n", strerror(errno));
+            else
+                fprintf(stderr, "Frame header at offset %" PRId64 " exceeds the end of the file\n",
+                        index->entries[j - 1].offset);
+            result = 0;
+            break;
         }
-        else if (strcmp(argv[cmdln_index], "-p") == 0)
-        {
-            if (cmdln_index + 1 >= argc)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
-                return 1;
-            }
-            if (sscanf(argv[cmdln_index + 1], "%d", &context.color_prim_update) != 1 ||
-                context.color_prim_update < 0 || context.color_prim_update > 0xff)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
-                return 1;
+
+        for (k = i; k < j; k++) {
+            uint8_t *frame_bytes = &buffer[index->entries[k].offset - start];
+            if (get_uint32(&frame_bytes[4]) != RDD36_FRAME_ID) {
+                fprintf(stderr, "Frame identifier not found at offset %" PRId64 "\n", index->entries[k].offset);
+                result = 0;
+                break;
             }
-            cmdln_index++;
-        }
-        else if (strcmp(argv[cmdln_index], "-o") == 0)
-        {
-            if (cmdln_index + 1 >= argc)
-            {
-                print_usage(argv[0]);
-                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
-                return 1;
+            if (context->show_props) {
+                print_props(&frame_bytes[patch_offset]);
+                break;
             }
-            offsets_filename = argv[cmdln_index + 1];
-            cmdln_index++;
+            update_header(context, &frame_bytes[patch_offset]);
         }
-        else
-        {
+        if (!result || context->show_props)
             break;
+
+        if (pwrite(fd, &buffer[patch_offset], end - (start + patch_offset), start + patch_offset) !=
+                end - (start + patch_offset))
+        {
+            fprintf(stderr, "Failed to update file: %s\n", strerror(errno));
+            result = 0;
         }
+        *update_count += j - i;
     }
 
-    if (cmdln_index + 1 < argc) {
-        print_usage(argv[0]);
-        fprintf(stderr, "Unknown option '%s'\n", argv[cmdln_index]);
-        return 1;
-    }
-    if (cmdln_index >= argc) {
-        print_usage(argv[0]);
-        fprintf(stderr, "Missing <filename>\n");
-        return 1;
-    }
+    free(buffer);
 
-    filename = argv[cmdln_index];
-    if (context.transfer_ch_update < 0 && context.matrix_coeff_update < 0 && context.color_prim_update < 0)
-      context.show_props = 1;
-    if (!offsets_filename)
-      context.skip_frame_data = 1;
+    return result;
+}
 
+static int patch_frames_pwrite(ParseContext *context, const FrameIndex *index)
+{
+    context->pass_count++;
+    return patch_frame_range(context, fileno(context->file), index, 0, index->count, &context->update_count);
+}
 
-    if (context.show_props)
-      context.file = fopen(filename, "rb");
-    else
-      context.file = fopen(filename, "r+b");
-    if (!context.file) {
-        fprintf(stderr, "Failed to open input file '%s': %s\n", filename, strerror(errno));
-        return 1;
+typedef struct
+{
+    const ParseContext *context;
+    const FrameIndex *index;
+    const char *filename;
+    size_t begin;
+    size_t end;
+    int64_t update_count;
+    int result;
+    int started;
+    pthread_t thread;
+} PatchShard;
+
+static void* patch_shard_thread(void *arg)
+{
+    PatchShard *shard = (PatchShard*)arg;
+    int fd;
+
+    // each worker has its own file descriptor so that the positional I/O isn't serialised on
+    // a shared file description
+    fd = open(shard->filename, O_RDWR);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open input file '%s': %s\n", shard->filename, strerror(errno));
+        shard->result = 0;
+        return NULL;
     }
 
-    if (offsets_filename) {
-        offsets_file = fopen(offsets_filename, "rb");
-        if (!offsets_file) {
-            fprintf(stderr, "Failed to open offsets file '%s': %s\n", offsets_filename, strerror(errno));
-            return 1;
+    shard->result = patch_frame_range(shard->context, fd, shard->index, shard->begin, shard->end,
+                                      &shard->update_count);
+
+    close(fd);
+
+    return NULL;
+}
+
+static int patch_frames_threaded(ParseContext *context, const FrameIndex *index, const char *filename,
+                                 unsigned num_threads)
+{
+    PatchShard *shards;
+    unsigned num_failed = 0;
+    unsigned i;
+
+    if (num_threads > index->count)
+        num_threads = (index->count > 0 ? (unsigned)index->count : 1);
+
+    shards = (PatchShard*)calloc(num_threads, sizeof(PatchShard));
+    CHK(shards);
+
+    // the shards together make a single pass over the frames
+    context->pass_count++;
+
+    // the sorted index is partitioned into contiguous shards of (almost) equal frame count
+    for (i = 0; i < num_threads; i++) {
+        shards[i].context  = context;
+        shards[i].index    = index;
+        shards[i].filename = filename;
+        shards[i].begin    = index->count * i / num_threads;
+        shards[i].end      = index->count * (i + 1) / num_threads;
+
+        errno = pthread_create(&shards[i].thread, NULL, patch_shard_thread, &shards[i]);
+        if (errno) {
+            fprintf(stderr, "Failed to create thread: %s\n", strerror(errno));
+            shards[i].result = 0;
+        } else {
+            shards[i].started = 1;
         }
     }
 
-    while (1) {
-        if (offsets_file) {
-            int64_t offset;
-            if (!read_next_frame_offset(offsets_file, &offset) || !seek_to_offset(&context, offset))
-                break;
-        } 
-        if (!have_byte(&context))
-            break;
-        if (!frame(&context)) {
-            result = 1;
-            break;
-        }
-        if (context.show_props)
-          break;
+    for (i = 0; i < num_threads; i++) {
+        if (shards[i].started)
+            pthread_join(shards[i].thread, NULL);
+        if (!shards[i].result)
+            num_failed++;
+        context->update_count += shards[i].update_count;
+    }
+
+    free(shards);
+
+    if (num_failed > 0) {
+        fprintf(stderr, "Failed to update %u of %u frame shards. Updated %" PRId64 " of %zu frames\n",
+                num_failed, num_threads, context->update_count, index->count);
+        return 0;
+    }
+
+    return 1;
+}
+
+#ifdef HAVE_IO_URING
+
+typedef struct
+{
+    int fd;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned num_queued;
+
+    void *cq_ring;
+    size_t cq_ring_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} URing;
+
+static int uring_open(URing *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    uint8_t *sq_ring;
+    uint8_t *cq_ring;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+        return 0;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) && ring->cq_ring_size > ring->sq_ring_size)
+        ring->sq_ring_size = ring->cq_ring_size;
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        return 0;
+    }
+    if ((params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            return 0;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        return 0;
+    }
+
+    sq_ring = (uint8_t*)ring->sq_ring;
+    ring->sq_head  = (unsigned*)(sq_ring + params.sq_off.head);
+    ring->sq_tail  = (unsigned*)(sq_ring + params.sq_off.tail);
+    ring->sq_mask  = (unsigned*)(sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq_ring + params.sq_off.array);
+
+    cq_ring = (uint8_t*)ring->cq_ring;
+    ring->cq_head = (unsigned*)(cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq_ring + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+
+    return 1;
+}
+
+static void uring_close(URing *ring)
+{
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+}
+
+static void uring_queue(URing *ring, int opcode, int fd, uint8_t *data, uint32_t size, int64_t offset,
+                        uint64_t user_data)
+{
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = (uint8_t)opcode;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)data;
+    sqe->len       = size;
+    sqe->off       = (uint64_t)offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->num_queued++;
+}
+
+static int uring_submit_and_wait(URing *ring, unsigned num_complete)
+{
+    int ret;
+
+    do {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, ring->num_queued, num_complete,
+                           IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        fprintf(stderr, "io_uring submit failed: %s\n", strerror(errno));
+        return 0;
+    }
+    ring->num_queued -= ret;
+
+    return 1;
+}
+
+static int uring_next_completion(URing *ring, uint64_t *user_data, int32_t *res)
+{
+    unsigned head = *ring->cq_head;
+    struct io_uring_cqe *cqe;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return 0;
+
+    cqe = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+static void queue_uring_reads(URing *ring, int fd, const FrameIndex *index, size_t start, size_t count,
+                              uint8_t *buffers, uint32_t read_size)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        uring_queue(ring, IORING_OP_READ, fd, &buffers[i * read_size], read_size, index->entries[start + i].offset, i);
+}
+
+// Waits for the <*in_flight> queued and submitted operations and counts the successful header writes. Every
+// operation is reaped, including when some of them fail, so that the kernel no longer uses the buffers.
+// Returns 0 if the wait itself failed, and sets <*result> to 0 if an operation failed
+static int reap_uring_completions(ParseContext *context, URing *ring, const FrameIndex *index, size_t read_start,
+                                  uint32_t read_size, size_t *in_flight, int *result)
+{
+    uint64_t user_data;
+    int32_t res;
+
+    if (!uring_submit_and_wait(ring, (unsigned)*in_flight))
+        return 0;
+    while (*in_flight > 0) {
+        if (!uring_next_completion(ring, &user_data, &res)) {
+            if (!uring_submit_and_wait(ring, 1))
+                return 0;
+            continue;
+        }
+        (*in_flight)--;
+        if (res < 0) {
+            fprintf(stderr, "io_uring %s failed: %s\n", (user_data & 0x80000000 ? "write" : "read"),
+                    strerror(-res));
+            *result = 0;
+        } else if (res != (user_data & 0x80000000 ? HEADER_PATCH_SIZE : (int32_t)read_size)) {
+            if (user_data & 0x80000000)
+                fprintf(stderr, "Failed to update file: short write\n");
+            else
+                fprintf(stderr, "Frame header at offset %" PRId64 " exceeds the end of the file\n",
+                        index->entries[read_start + user_data].offset);
+            *result = 0;
+        } else if (user_data & 0x80000000) {
+            context->update_count++;
+        }
+    }
+
+    return 1;
+}
+
+static int patch_frames_uring(ParseContext *context, const FrameIndex *index, unsigned queue_depth, int *available)
+{
+    const int64_t patch_offset = FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET;
+    const uint32_t read_size = (uint32_t)(patch_offset + HEADER_PATCH_SIZE);
+    int fd = fileno(context->file);
+    URing ring;
+    uint8_t *buffers;
+    uint8_t *read_buffers;
+    size_t read_start = 0;
+    size_t read_count;
+    size_t in_flight;
+    int result = 1;
+
+    // reads of the next batch are in flight together with the writes of the current batch
+    if (!uring_open(&ring, queue_depth * 2)) {
+        fprintf(stderr, "io_uring is not available: %s\n", strerror(errno));
+        uring_close(&ring);
+        *available = 0;
+        return 0;
+    }
+    *available = 1;
+
+    buffers = (uint8_t*)malloc(2 * (size_t)queue_depth * read_size);
+    if (!buffers) {
+        uring_close(&ring);
+        return 0;
+    }
+    read_buffers = buffers;
+    context->pass_count++;
+
+    read_count = (index->count < queue_depth ? index->count : queue_depth);
+    queue_uring_reads(&ring, fd, index, read_start, read_count, read_buffers, read_size);
+    in_flight = read_count;
+
+    while (in_flight > 0) {
+        size_t i;
+
+        if (!reap_uring_completions(context, &ring, index, read_start, read_size, &in_flight, &result)) {
+            // the kernel may still be using the buffers and so they are not freed
+            uring_close(&ring);
+            return 0;
+        }
+        if (!result || read_count == 0)
+            break;
+
+        for (i = 0; i < read_count; i++) {
+            uint8_t *frame_bytes = &read_buffers[i * read_size];
+            if (get_uint32(&frame_bytes[4]) != RDD36_FRAME_ID) {
+                fprintf(stderr, "Frame identifier not found at offset %" PRId64 "\n",
+                        index->entries[read_start + i].offset);
+                result = 0;
+                break;
+            }
+            if (context->show_props) {
+                print_props(&frame_bytes[patch_offset]);
+                break;
+            }
+            update_header(context, &frame_bytes[patch_offset]);
+            uring_queue(&ring, IORING_OP_WRITE, fd, &frame_bytes[patch_offset], HEADER_PATCH_SIZE,
+                        index->entries[read_start + i].offset + patch_offset, 0x80000000 | i);
+            in_flight++;
+        }
+        if (!result || context->show_props) {
+            // complete the updates preceding the invalid frame
+            read_count = 0;
+            continue;
+        }
+
+        read_start += read_count;
+        read_buffers = (read_buffers == buffers ? &buffers[(size_t)queue_depth * read_size] : buffers);
+        read_count = index->count - read_start;
+        if (read_count > queue_depth)
+            read_count = queue_depth;
+        queue_uring_reads(&ring, fd, index, read_start, read_count, read_buffers, read_size);
+        in_flight += read_count;
+    }
+
+    free(buffers);
+    uring_close(&ring);
+
+    return result;
+}
+
+#endif
+
+static int copy_file_data(int src_fd, int dst_fd, int64_t size, const char **method)
+{
+    int64_t rem_size = size;
+    int use_copy_file_range = 1;
+    ssize_t num_copied;
+
+    *method = "copy_file_range";
+    while (rem_size > 0) {
+        size_t count = (rem_size > 0x40000000 ? 0x40000000 : (size_t)rem_size);
+
+        if (use_copy_file_range) {
+            num_copied = copy_file_range(src_fd, NULL, dst_fd, NULL, count, 0);
+            if (num_copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                // not supported for this kernel or pair of filesystems
+                use_copy_file_range = 0;
+                *method = "sendfile";
+                continue;
+            }
+        } else {
+            num_copied = sendfile(dst_fd, src_fd, NULL, count);
+        }
+        if (num_copied < 0) {
+            fprintf(stderr, "Failed to copy file data: %s\n", strerror(errno));
+            return 0;
+        }
+        if (num_copied == 0) {
+            fprintf(stderr, "Failed to copy file data: unexpected end of file\n");
+            return 0;
+        }
+        rem_size -= num_copied;
+    }
+
+    return 1;
+}
+
+static int open_output_file(const struct stat *src_st, const char *dst_filename)
+{
+    struct stat dst_st;
+    int dst_fd;
+
+    // the output file is truncated and so it must not be the input file
+    if (stat(dst_filename, &dst_st) == 0 && dst_st.st_dev == src_st->st_dev && dst_st.st_ino == src_st->st_ino) {
+        fprintf(stderr, "Output file '%s' is the same as the input file\n", dst_filename);
+        return -1;
+    }
+
+    dst_fd = open(dst_filename, O_WRONLY | O_CREAT | O_TRUNC, src_st->st_mode & 0777);
+    if (dst_fd < 0)
+        fprintf(stderr, "Failed to open output file '%s': %s\n", dst_filename, strerror(errno));
+
+    return dst_fd;
+}
+
+// Clones the input file using a copy-on-write reflink if the filesystem supports it. Otherwise
+// the file data is copied within the kernel
+static int clone_file(const char *src_filename, const char *dst_filename, const char **method)
+{
+    struct stat src_st;
+    int src_fd, dst_fd;
+    int result = 1;
+
+    src_fd = open(src_filename, O_RDONLY);
+    if (src_fd < 0) {
+        fprintf(stderr, "Failed to open input file '%s': %s\n", src_filename, strerror(errno));
+        return 0;
+    }
+    if (fstat(src_fd, &src_st) < 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        close(src_fd);
+        return 0;
+    }
+    dst_fd = open_output_file(&src_st, dst_filename);
+    if (dst_fd < 0) {
+        close(src_fd);
+        return 0;
+    }
+
+#ifdef FICLONE
+    if (ioctl(dst_fd, FICLONE, src_fd) == 0)
+        *method = "reflink";
+    else
+#endif
+        result = copy_file_data(src_fd, dst_fd, src_st.st_size, method);
+
+    if (close(dst_fd) < 0 && result) {
+        fprintf(stderr, "Failed to close output file '%s': %s\n", dst_filename, strerror(errno));
+        result = 0;
+    }
+    close(src_fd);
+
+    return result;
+}
+
+static void copy_overlap(uint8_t *block, int64_t block_pos, size_t block_size, int64_t patch_pos,
+                         const uint8_t *patch, size_t patch_size)
+{
+    int64_t start = (patch_pos > block_pos ? patch_pos : block_pos);
+    int64_t end = patch_pos + (int64_t)patch_size;
+
+    if (end > block_pos + (int64_t)block_size)
+        end = block_pos + (int64_t)block_size;
+    if (start < end)
+        memcpy(&block[start - block_pos], &patch[start - patch_pos], end - start);
+}
+
+static int read_block(int fd, uint8_t *data, size_t size, int64_t offset, size_t *num_read)
+{
+    ssize_t result;
+
+    *num_read = 0;
+    while (*num_read < size) {
+        result = pread(fd, &data[*num_read], size - *num_read, offset + *num_read);
+        if (result < 0) {
+            fprintf(stderr, "File read error: %s\n", strerror(errno));
+            return 0;
+        }
+        if (result == 0)
+            break;
+        *num_read += result;
+    }
+
+    return 1;
+}
+
+static int write_block(int fd, const uint8_t *data, size_t size)
+{
+    ssize_t result;
+
+    while (size > 0) {
+        result = write(fd, data, size);
+        if (result < 0) {
+            fprintf(stderr, "Failed to write output file: %s\n", strerror(errno));
+            return 0;
+        }
+        data += result;
+        size -= result;
+    }
+
+    return 1;
+}
+
+// Copies the input file to the output file in large sequential blocks and applies the frame header
+// and 'colr' atom updates to the blocks before they are written
+static int patch_frames_stream(ParseContext *context, const FrameIndex *index, const MOVInfo *colr_info,
+                               const char *dst_filename)
+{
+    const int64_t patch_offset = FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET;
+    const int64_t patch_end = patch_offset + HEADER_PATCH_SIZE;
+    int src_fd = fileno(context->file);
+    struct stat src_st;
+    uint8_t colr_patch[6];
+    uint8_t header[FRAME_HEADER_OFFSET + HEADER_PATCH_OFFSET + HEADER_PATCH_SIZE];
+    int64_t pending_offset = -1;
+    uint8_t pending_patch[HEADER_PATCH_SIZE];
+    void *buffer = NULL;
+    int64_t pos = 0;
+    size_t num_read;
+    size_t i = 0;
+    int dst_fd;
+    int result = 1;
+
+    if (colr_info)
+        get_colr_patch(context, colr_info, colr_patch);
+
+    if (fstat(src_fd, &src_st) < 0) {
+        fprintf(stderr, "Failed to stat file: %s\n", strerror(errno));
+        return 0;
+    }
+    dst_fd = open_output_file(&src_st, dst_filename);
+    if (dst_fd < 0)
+        return 0;
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    if (posix_memalign(&buffer, STREAM_BLOCK_ALIGNMENT, STREAM_BLOCK_SIZE) != 0) {
+        fprintf(stderr, "Failed to allocate stream buffer\n");
+        close(dst_fd);
+        return 0;
+    }
+    context->pass_count++;
+
+    while (result) {
+        uint8_t *block = (uint8_t*)buffer;
+        int64_t block_end;
+
+        if (!read_block(src_fd, block, STREAM_BLOCK_SIZE, pos, &num_read)) {
+            result = 0;
+            break;
+        }
+        if (num_read == 0)
+            break;
+        block_end = pos + num_read;
+
+        // the remainder of a header update that straddled the previous block boundary
+        if (pending_offset >= 0) {
+            copy_overlap(block, pos, num_read, pending_offset, pending_patch, HEADER_PATCH_SIZE);
+            pending_offset = -1;
+        }
+
+        for (; i < index->count && index->entries[i].offset + patch_offset < block_end; i++) {
+            int64_t offset = index->entries[i].offset;
+
+            if (offset >= pos && offset + patch_end <= block_end) {
+                memcpy(header, &block[offset - pos], sizeof(header));
+            } else if (pread(src_fd, header, sizeof(header), offset) != sizeof(header)) {
+                fprintf(stderr, "Frame header at offset %" PRId64 " exceeds the end of the file\n", offset);
+                result = 0;
+                break;
+            }
+            if (get_uint32(&header[4]) != RDD36_FRAME_ID) {
+                fprintf(stderr, "Frame identifier not found at offset %" PRId64 "\n", offset);
+                result = 0;
+                break;
+            }
+
+            update_header(context, &header[patch_offset]);
+            copy_overlap(block, pos, num_read, offset + patch_offset, &header[patch_offset], HEADER_PATCH_SIZE);
+            if (offset + patch_end > block_end) {
+                pending_offset = offset + patch_offset;
+                memcpy(pending_patch, &header[patch_offset], HEADER_PATCH_SIZE);
+            }
+            context->update_count++;
+        }
+        if (colr_info)
+            copy_overlap(block, pos, num_read, colr_info->colr_offset, colr_patch, sizeof(colr_patch));
+
+        if (result && !write_block(dst_fd, block, num_read))
+            result = 0;
+        pos = block_end;
+    }
+    if (result && i < index->count) {
+        fprintf(stderr, "Frame header at offset %" PRId64 " exceeds the end of the file\n", index->entries[i].offset);
+        result = 0;
+    }
+
+    free(buffer);
+    if (close(dst_fd) < 0 && result) {
+        fprintf(stderr, "Failed to close output file '%s': %s\n", dst_filename, strerror(errno));
+        result = 0;
+    }
+
+    return result;
+}
+
+static void print_usage(const char *cmd)
+{
+    fprintf(stderr, "Usage: %s [options] <filename>\n", cmd);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -h | --help    Show help and exit\n");
+    fprintf(stderr, "  -s             Show properties in the first frame and exit\n");
+    fprintf(stderr, "  -p <val>       Modify the 'color_primaries' property to <val>\n");
+    fprintf(stderr, "  -t <val>       Modify the 'transfer_characteristic' property to <val>\n");
+    fprintf(stderr, "  -m <val>       Modify the 'matrix_coefficients' property to <val>\n");
+    fprintf(stderr, "  -a <val>       Modify the 'aspect_ratio_information' property to <val>\n");
+    fprintf(stderr, "  -r <val>       Modify the 'frame_rate_code' property to <val>\n");
+    fprintf(stderr, "  -o <file>      Text file containing decimal file offsets for each frame separated by a newline\n");
+    fprintf(stderr, "                     E.g. using ffprobe to extract offsets from a Quicktime file:\n");
+    fprintf(stderr, "                     'ffprobe -show_packets -select_streams v:0 example.mov | grep pos >offsets.txt'\n");
+    fprintf(stderr, "  -q             Resolve frame offsets from the sample tables of the first video track in a Quicktime file\n");
+    fprintf(stderr, "  --scan         Locate the frames by searching for the 'icpf' frame_identifier rather than walking the\n");
+    fprintf(stderr, "                 frame_size fields, e.g. a raw bitstream with padding or a Quicktime file without usable\n");
+    fprintf(stderr, "                 sample tables where the frames are interleaved with audio\n");
+    fprintf(stderr, "  --index <file>  Binary frame index file created using '--write-index'\n");
+    fprintf(stderr, "  --write-index <file>  Write a binary frame index file that can be used with '--index'. The file\n");
+    fprintf(stderr, "                  identifies the modified file\n");
+    fprintf(stderr, "  -c             Also modify the 'colr' atom in the video sample description. Requires '-q'\n");
+    fprintf(stderr, "  --start <frame> Start modifying at frame number <frame>. Default 0\n");
+    fprintf(stderr, "  --count <n>     Modify at most <n> frames\n");
+    fprintf(stderr, "  --every <n>     Modify every <n>th frame. Default 1\n");
+    fprintf(stderr, "  --output <file>  Clone <filename> to <file> and modify <file>. The clone is a copy-on-write reflink if\n");
+    fprintf(stderr, "                   supported by the filesystem, otherwise it is copied using copy_file_range or sendfile\n");
+    fprintf(stderr, "  --io <name>    File I/O method used to read and update the frame headers. <name> is one of:\n");
+    fprintf(stderr, "                     'stdio': buffered stdio seek, read and write (default)\n");
+    fprintf(stderr, "                     'mmap':  access the frame headers in a shared memory mapping of the file\n");
+    fprintf(stderr, "                     'pwrite': positional reads and writes in sorted file offset order\n");
+    fprintf(stderr, "                     'uring':  batches of io_uring reads and writes in sorted file offset order\n");
+    fprintf(stderr, "                               Falls back to 'stdio' if io_uring is not available\n");
+    fprintf(stderr, "                     'stream': copy <filename> to the '--output' file in large sequential blocks and\n");
+    fprintf(stderr, "                               update the frame headers and 'colr' atom in the blocks before they are written\n");
+    fprintf(stderr, "  --queue-depth <n>  Number of frame header reads or writes submitted in a batch with '--io uring'. Default %u\n",
+            DEFAULT_QUEUE_DEPTH);
+    fprintf(stderr, "  -j <n>         Update the frame headers using <n> threads with 'pwrite' I/O. Each thread updates a\n");
+    fprintf(stderr, "                 contiguous shard of the sorted frame offsets using its own file descriptor\n");
+    fprintf(stderr, "  --stats        Print the number of fields and frames updated, the number of update and read-back\n");
+    fprintf(stderr, "                 passes and the frame rate\n");
+}
+
+int main(int argc, const char **argv)
+{
+    const char *offsets_filename = NULL;
+    const char *index_filename = NULL;
+    const char *write_index_filename = NULL;
+    const char *output_filename = NULL;
+    const char *clone_method = NULL;
+    int use_mov_info = 0;
+    int scan_frames = 0;
+    int update_colr = 0;
+    IOMethod io_method = STDIO_IO;
+    unsigned queue_depth = DEFAULT_QUEUE_DEPTH;
+    unsigned num_threads = 1;
+    int io_method_set = 0;
+    int64_t start_frame = 0;
+    int64_t frame_count = -1;
+    int64_t frame_step = 1;
+    int select_frames;
+    int print_stats = 0;
+    struct timespec start_time, end_time;
+    const char *filename;
+    int cmdln_index;
+    ParseContext context;
+    FrameIndex offsets_index;
+    MOVInfo mov_info;
+    FrameIndex *frame_index = NULL;
+    size_t frame_num = 0;
+    int verify_pass_count = 0;
+    int result = 0;
+
+    be_decode_init();
+
+    memset(&context, 0, sizeof(context));
+    context.next_bit = -1;
+    context.transfer_ch_update = -1;
+    context.matrix_coeff_update = -1;
+    context.aspect_ratio_update = -1;
+    context.frame_rate_update = -1;
+    context.color_prim_update = -1;
+
+    if (argc <= 1) {
+        print_usage(argv[0]);
+        return 0;
+    }
+
+    for (cmdln_index = 1; cmdln_index < argc; cmdln_index++) {
+        if (strcmp(argv[cmdln_index], "-h") == 0 ||
+            strcmp(argv[cmdln_index], "--help") == 0)
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (strcmp(argv[cmdln_index], "-s") == 0)
+        {
+            context.show_props = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "-t") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%d", &context.transfer_ch_update) != 1 ||
+                context.transfer_ch_update < 0 || context.transfer_ch_update > 0xff)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-m") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%d", &context.matrix_coeff_update) != 1 ||
+                context.matrix_coeff_update < 0 || context.matrix_coeff_update > 0xff)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-p") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%d", &context.color_prim_update) != 1 ||
+                context.color_prim_update < 0 || context.color_prim_update > 0xff)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-a") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%d", &context.aspect_ratio_update) != 1 ||
+                context.aspect_ratio_update < 0 || context.aspect_ratio_update > 0x0f)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-r") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%d", &context.frame_rate_update) != 1 ||
+                context.frame_rate_update < 0 || context.frame_rate_update > 0x0f)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-o") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            offsets_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-q") == 0)
+        {
+            use_mov_info = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--scan") == 0)
+        {
+            scan_frames = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--index") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            index_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--write-index") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            write_index_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-c") == 0)
+        {
+            update_colr = 1;
+        }
+        else if (strcmp(argv[cmdln_index], "--start") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &start_frame) != 1 || start_frame < 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--count") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &frame_count) != 1 || frame_count < 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--every") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%" SCNd64, &frame_step) != 1 || frame_step <= 0)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--output") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            output_filename = argv[cmdln_index + 1];
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--io") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (strcmp(argv[cmdln_index + 1], "stdio") == 0)
+            {
+                io_method = STDIO_IO;
+            }
+            else if (strcmp(argv[cmdln_index + 1], "mmap") == 0)
+            {
+                io_method = MMAP_IO;
+            }
+            else if (strcmp(argv[cmdln_index + 1], "pwrite") == 0)
+            {
+                io_method = PWRITE_IO;
+            }
+            else if (strcmp(argv[cmdln_index + 1], "uring") == 0)
+            {
+                io_method = URING_IO;
+            }
+            else if (strcmp(argv[cmdln_index + 1], "stream") == 0)
+            {
+                io_method = STREAM_IO;
+            }
+            else
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            io_method_set = 1;
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--queue-depth") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%u", &queue_depth) != 1 ||
+                queue_depth == 0 || queue_depth > MAX_QUEUE_DEPTH)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "-j") == 0)
+        {
+            if (cmdln_index + 1 >= argc)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Missing argument for option '%s'\n", argv[cmdln_index]);
+                return 1;
+            }
+            if (sscanf(argv[cmdln_index + 1], "%u", &num_threads) != 1 ||
+                num_threads == 0 || num_threads > MAX_THREADS)
+            {
+                print_usage(argv[0]);
+                fprintf(stderr, "Invalid value '%s' for option '%s'\n", argv[cmdln_index + 1], argv[cmdln_index]);
+                return 1;
+            }
+            cmdln_index++;
+        }
+        else if (strcmp(argv[cmdln_index], "--stats") == 0)
+        {
+            print_stats = 1;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (cmdln_index + 1 < argc) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Unknown option '%s'\n", argv[cmdln_index]);
+        return 1;
+    }
+    if (cmdln_index >= argc) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Missing <filename>\n");
+        return 1;
+    }
+
+    filename = argv[cmdln_index];
+    if (context.transfer_ch_update < 0 && context.matrix_coeff_update < 0 && context.color_prim_update < 0 &&
+        context.aspect_ratio_update < 0 && context.frame_rate_update < 0)
+      context.show_props = 1;
+    if (offsets_filename && use_mov_info) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Options '-o' and '-q' can't be used together\n");
+        return 1;
+    }
+    select_frames = (start_frame > 0 || frame_count >= 0 || frame_step > 1);
+    if (update_colr && !use_mov_info) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '-c' requires option '-q'\n");
+        return 1;
+    }
+    if (output_filename && context.show_props) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--output' requires a property to be modified\n");
+        return 1;
+    }
+    if (io_method == STREAM_IO && (!output_filename || context.show_props)) {
+        print_usage(argv[0]);
+        fprintf(stderr, "The 'stream' I/O method requires option '--output' and a property to be modified\n");
+        return 1;
+    }
+    if (index_filename && (offsets_filename || use_mov_info)) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--index' can't be used together with '-o' or '-q'\n");
+        return 1;
+    }
+    if (scan_frames && (offsets_filename || use_mov_info || index_filename)) {
+        print_usage(argv[0]);
+        fprintf(stderr, "Option '--scan' can't be used together with '-o', '-q' or '--index'\n");
+        return 1;
+    }
+    if (!offsets_filename && !use_mov_info && !index_filename && !scan_frames)
+      context.skip_frame_data = 1;
+    if (num_threads > 1) {
+        if (io_method_set && io_method != PWRITE_IO) {
+            print_usage(argv[0]);
+            fprintf(stderr, "Option '-j' can only be used with the 'pwrite' I/O method\n");
+            return 1;
+        }
+        io_method = PWRITE_IO;
+    }
+
+
+    if (output_filename && io_method != STREAM_IO) {
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        if (!clone_file(filename, output_filename, &clone_method))
+            return 1;
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        if (print_stats) {
+            printf("Cloned '%s' to '%s' using %s in %.3f sec\n", filename, output_filename, clone_method,
+                   (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9);
+        }
+        filename = output_filename;
+    }
+
+    if (context.show_props)
+      context.file = fopen(filename, "rb");
+    else
+      context.file = fopen(filename, "r+b");
+    if (!context.file) {
+        fprintf(stderr, "Failed to open input file '%s': %s\n", filename, strerror(errno));
+        return 1;
+    }
+
+    frame_index_init(&offsets_index);
+    mov_info_init(&mov_info);
+    if (index_filename) {
+        if (!mov_read_frame_index_file(context.file, &offsets_index, index_filename))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (offsets_filename) {
+        if (!frame_index_read_offsets_file(&offsets_index, offsets_filename))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (use_mov_info) {
+        if (!mov_read_info(context.file, &mov_info)) {
+            fprintf(stderr, "Failed to read frame offsets from Quicktime file '%s'\n", filename);
+            return 1;
+        }
+        frame_index = &mov_info.frame_index;
+        if (update_colr && !mov_info.have_colr) {
+            fprintf(stderr, "No 'colr' atom found in the video sample description of '%s'\n", filename);
+            return 1;
+        }
+    }
+
+    if (context.show_props && mov_info.have_colr)
+        print_colr_props(mov_info.colr);
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    if (update_colr && !context.show_props && io_method != STREAM_IO && !update_colr_atom(&context, &mov_info))
+        return 1;
+
+    if (!frame_index && scan_frames) {
+        if (!frame_index_scan_file(&offsets_index, fileno(context.file), 0, -1))
+            return 1;
+        frame_index = &offsets_index;
+    } else if (!frame_index && (select_frames || write_index_filename ||
+                                io_method == PWRITE_IO || io_method == URING_IO || io_method == STREAM_IO))
+    {
+        if (!frame_index_scan_raw_file(&offsets_index, fileno(context.file)))
+            return 1;
+        frame_index = &offsets_index;
+    }
+    if (write_index_filename) {
+        // the source identity is updated once the file has been modified
+        FrameIndexSource source;
+        if (!frame_index_get_source(fileno(context.file), &source) ||
+            !frame_index_write_file(frame_index, &source, write_index_filename))
+        {
+            return 1;
+        }
+    }
+    if (select_frames)
+        frame_index_select(frame_index, start_frame, frame_count, frame_step);
+    if (io_method == PWRITE_IO || io_method == URING_IO || io_method == STREAM_IO)
+        frame_index_sort(frame_index);
+
+    if (io_method == URING_IO) {
+#ifdef HAVE_IO_URING
+        int available = 0;
+        if (!patch_frames_uring(&context, frame_index, queue_depth, &available) && available)
+            result = 1;
+        if (!available) {
+            fprintf(stderr, "Falling back to stdio\n");
+            io_method = STDIO_IO;
+        }
+#else
+        fprintf(stderr, "io_uring is not supported by this build. Falling back to stdio\n");
+        io_method = STDIO_IO;
+#endif
+    }
+
+    if (io_method == STREAM_IO) {
+        if (!patch_frames_stream(&context, frame_index, (update_colr ? &mov_info : NULL), output_filename))
+            result = 1;
+
+        // the update is verified in the output file
+        fclose(context.file);
+        context.file = fopen(output_filename, "rb");
+        if (!context.file) {
+            fprintf(stderr, "Failed to open output file '%s': %s\n", output_filename, strerror(errno));
+            return 1;
+        }
+    } else if (io_method == PWRITE_IO) {
+        if (num_threads > 1 && !context.show_props) {
+            if (!patch_frames_threaded(&context, frame_index, filename, num_threads))
+                result = 1;
+        } else if (!patch_frames_pwrite(&context, frame_index)) {
+            result = 1;
+        }
+    } else if (io_method == STDIO_IO || io_method == MMAP_IO) {
+        if (io_method == MMAP_IO && !map_file(&context))
+            return 1;
+
+        if (!context.show_props)
+            context.pass_count++;
+        while (1) {
+            if (frame_index) {
+                if (frame_num >= frame_index->count ||
+                    !seek_to_offset(&context, frame_index->entries[frame_num].offset))
+                {
+                    break;
+                }
+                frame_num++;
+            }
+            if (!have_byte(&context))
+                break;
+            if (!frame_index && !context.show_props &&
+                !frame_index_append(&offsets_index, get_file_pos(&context), 0))
+            {
+                result = 1;
+                break;
+            }
+            if (!frame(&context)) {
+                result = 1;
+                break;
+            }
+            if (context.show_props)
+              break;
+        }
+
+        if (!unmap_file(&context))
+            result = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    if (!context.show_props && result == 0 && context.update_count > 0) {
+        verify_pass_count++;
+        // the offsets of the frames found by walking the raw bitstream were recorded in the offsets index
+        FrameIndex *verify_index = (frame_index ? frame_index : &offsets_index);
+        fflush(context.file);
+        frame_index_sort(verify_index);
+        if (!verify_update(&context, verify_index, (update_colr ? &mov_info : NULL)))
+            result = 1;
+    }
+    if (result == 0 && (write_index_filename || (index_filename && !output_filename && context.update_count > 0))) {
+        // the modification changes the file's modification time and possibly the 'moov' atom, and so the index
+        // files are updated to identify the modified file
+        FrameIndexSource source;
+        fflush(context.file);
+        if (!mov_get_frame_index_source(context.file, &source) ||
+            (write_index_filename && !frame_index_update_file_source(write_index_filename, &source)) ||
+            (index_filename && !output_filename && context.update_count > 0 &&
+                !frame_index_update_file_source(index_filename, &source)))
+        {
+            result = 1;
+        }
+    }
+    if (print_stats && !context.show_props) {
+        double secs = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+        int num_fields = (context.aspect_ratio_update >= 0) + (context.frame_rate_update >= 0) +
+                         (context.color_prim_update >= 0) + (context.transfer_ch_update >= 0) +
+                         (context.matrix_coeff_update >= 0);
+        printf("Updated %d field(s) in %" PRId64 " frames in %d pass(es) in %.3f sec (%.1f frames/sec)\n",
+               num_fields, context.update_count, context.pass_count, secs,
+               (secs > 0.0 ? context.update_count / secs : 0.0));
+        printf("Verified the update in %d read-back pass(es)\n", verify_pass_count);
     }
 
     if (context.file)
         fclose(context.file);
-    if (offsets_file)
-        fclose(offsets_file);
+    frame_index_clear(&offsets_index);
+    mov_info_clear(&mov_info);
 
 
     return result;